@@ -1,20 +1,24 @@
 #define MINIAUDIO_IMPLEMENTATION
 #include <MiniAudio/miniaudio.h>
-#include <GLFW/glfw3.h>
 
 #include <cstring>
 #include <thread>
 #include "APU.h"
 #include "../GBCore.h"
 #include "../Utils/bitOps.h"
+#include "../Utils/profiler.h"
  
 APU::APU(GBCore& gbCore) : gb(gbCore)
 {}
 
 APU::~APU()
 {
-	if (soundDevice != nullptr)
-		ma_device_uninit(soundDevice.get());
+	{
+		std::lock_guard lock { soundDeviceMutex };
+
+		if (soundDeviceInitialized)
+			ma_device_uninit(soundDevice.get());
+	}
 
 	if (isRecording)
 		stopRecording();
@@ -40,10 +44,13 @@ void APU::loadState(std::istream& st)
 	ST_READ(channel2);
 	ST_READ(channel3.s); ST_READ(channel3.regs); ST_READ_ARR(channel3.waveRAM);
 	ST_READ(channel4); 
+
+	pendingCycles = 0;
 }
 
 void APU::reset()
 {
+#ifndef MEGABOY_HEADLESS
 	if (soundDevice == nullptr)
 	{
 #ifdef EMSCRIPTEN
@@ -53,6 +60,7 @@ void APU::reset()
 		t.detach();
 #endif
 	}
+#endif
 
 	regs.NR50 = 0x77;
 	regs.NR51 = 0xF3;
@@ -60,6 +68,23 @@ void APU::reset()
 
 	frameSequencerCycles = 0;
 	frameSequencerStep = 0;
+	pendingCycles = 0;
+
+	blipSpeedFactor = speedFactor;
+	leftBuffer.setRates(CPU_FREQUENCY * speedFactor, NATIVE_SAMPLE_RATE);
+	rightBuffer.setRates(CPU_FREQUENCY * speedFactor, NATIVE_SAMPLE_RATE);
+	resampler.setRates(NATIVE_SAMPLE_RATE, sampleRate);
+	resampler.reset();
+
+	blipTime = 0;
+	leftAmplitude = rightAmplitude = 0;
+	leftBuffer.clear();
+	rightBuffer.clear();
+
+	for (auto& buffer : stemBuffers)
+		buffer.clear();
+
+	stemAmplitudes.fill(0);
 
 	channel1.reset();
 	channel2.reset();
@@ -76,139 +101,100 @@ void APU::powerOff()
 
 void sound_data_callback(ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount)
 {
-	auto& gb { *static_cast<GBCore*>(pDevice->pUserData) };
-	auto& apu { gb.apu };
+	auto& apu { static_cast<GBCore*>(pDevice->pUserData)->apu };
 	auto* pOutput16 { static_cast<int16_t*>(pOutput) };
 
-	const bool mainThreadBlocked { APU::isMainThreadBlocked || ((glfwGetTime() - APU::lastMainThreadTime) > 0.1) };
-	const bool emulationStopped { gb.emulationPaused || gb.breakpointHit || !gb.executingProgram() || mainThreadBlocked };
+	// After running dry, playback only resumes once the target latency is buffered again, so jitter doesn't cause constant crackling.
+	const size_t startThreshold { (static_cast<size_t>(pDevice->sampleRate) * apu.targetLatency / 1000) * APU::CHANNELS };
 
-	if (!appConfig::enableAudio || emulationStopped || !apu.enabled())
-	{
-		if (!emulationStopped && apu.enabled())
-			apu.execute(static_cast<int>(APU::CYCLES_PER_SAMPLE * frameCount));
-
-		std::memset(pOutput16, 0, sizeof(int16_t) * frameCount * APU::CHANNELS);
-		return;
-	}
-
-	constexpr int WHOLE_CYCLES { static_cast<int>(APU::CYCLES_PER_SAMPLE) };
-	static double remainder { 0.0 };
+	const size_t sampleCount { frameCount * APU::CHANNELS };
+	size_t readCount { 0 };
 
-	for (ma_uint32 i = 0; i < frameCount; i++)
+	if (apu.outputPlaying || apu.sampleRing.size() >= startThreshold)
 	{
-		const int cycles { static_cast<int>(WHOLE_CYCLES + remainder) };
-		apu.execute(cycles);
-		remainder += APU::CYCLES_PER_SAMPLE - cycles;
+		readCount = apu.sampleRing.pop(pOutput16, sampleCount);
 
-		const auto samples { apu.generateSamples() };
+		if (readCount != sampleCount)
+		{
+			if (apu.outputPlaying)
+				apu.underruns++;
 
-		pOutput16[i * 2] = samples.first;
-		pOutput16[i * 2 + 1] = samples.second;
+			apu.outputPlaying = false;
+		}
+		else
+			apu.outputPlaying = true;
 	}
 
-	if (apu.isRecording)
-	{
-		const size_t bufferLen { apu.recordingBuffer.size() };
-		const size_t newBufferLen { bufferLen + (frameCount * APU::CHANNELS) };
-
-		apu.recordingBuffer.resize(newBufferLen);
-		std::memcpy(&apu.recordingBuffer[bufferLen], pOutput16, sizeof(int16_t) * frameCount * APU::CHANNELS);
-
-		if (newBufferLen >= APU::SAMPLE_RATE)
-		{		
-			apu.recordingStream.write(reinterpret_cast<char*>(apu.recordingBuffer.data()), newBufferLen * sizeof(int16_t));
-			apu.recordingBuffer.clear();
-		}
+	std::memset(pOutput16 + readCount, 0, sizeof(int16_t) * (sampleCount - readCount));
 
-		apu.recordedSeconds += (static_cast<float>(frameCount) / APU::SAMPLE_RATE);
+	if (!appConfig::enableAudio)
+	{
+		std::memset(pOutput16, 0, sizeof(int16_t) * sampleCount);
+		return;
 	}
-}
 
-void APU::startRecording(const std::filesystem::path& filePath)
-{
-	isRecording = true;
-	recordingStream = std::ofstream { filePath, std::ios::binary };
-	recordingBuffer.reserve(SAMPLE_RATE);
-	writeWAVHeader();
+	if (apu.isRecording && readCount > 0)
+		apu.recorder.write(pOutput16, readCount);
 }
 
-#define WRITE(val) recordingStream.write(reinterpret_cast<const char*>(&val), sizeof(val));
-
-void APU::writeWAVHeader()
+bool APU::startRecording(const std::filesystem::path& filePath, RecordingFormat format)
 {
-	constexpr uint16_t BITS_PER_SAMPLE = sizeof(int16_t) * CHAR_BIT;
-	constexpr uint32_t BYTE_RATE = SAMPLE_RATE * sizeof(int16_t) * CHANNELS;
-	constexpr uint32_t SECTION_CHUNK_SIZE = 16;
-	constexpr uint16_t BLOCK_ALIGN = (BITS_PER_SAMPLE * CHANNELS) / CHAR_BIT;
-	constexpr uint16_t PCM_FORMAT = 1;
-
-	recordingStream.write("RIFF", 4);
-
-	uint32_t lengthReserve{};
-	WRITE(lengthReserve);
-	recordingStream.write("WAVE", 4);
-	recordingStream.write("fmt ", 4);
-
-	WRITE(SECTION_CHUNK_SIZE);
-	WRITE(PCM_FORMAT);
-	WRITE(CHANNELS);
-	WRITE(SAMPLE_RATE);
-	WRITE(BYTE_RATE);
-	WRITE(BLOCK_ALIGN);
-	WRITE(BITS_PER_SAMPLE);
-
-	recordingStream.write("data", 4);
-
-	uint32_t dataLengthReserve{};
-	WRITE(dataLengthReserve);
+	isRecording = recorder.start(filePath, sampleRate, format);
+	return isRecording;
 }
 
 void APU::stopRecording()
 {
 	isRecording = false;
-	recordedSeconds = 0.f;
-
-	if (!recordingBuffer.empty())
-	{
-		recordingStream.write(reinterpret_cast<char*>(recordingBuffer.data()), recordingBuffer.size() * sizeof(int16_t));
-		recordingBuffer.clear();
-	}
-
-	recordingStream.seekp(0, std::ios::end);
-	const uint32_t fileSize = static_cast<uint32_t>(recordingStream.tellp()) - 8;
-
-	recordingStream.seekp(4, std::ios::beg);
-	WRITE(fileSize);
-
-	const uint32_t dataSize = fileSize - 36; // Header is 44 bytes, 44 - 8 = 36.
-	recordingStream.seekp(40, std::ios::beg);
-	WRITE(dataSize);
-
-	recordingStream.close();
+	recorder.stop();
 }
 
-#undef WRITE
-
 void APU::initMiniAudio()
 {
-	soundDevice = std::make_unique<ma_device>();
+	std::lock_guard lock { soundDeviceMutex };
+
+	if (soundDevice == nullptr)
+		soundDevice = std::make_unique<ma_device>();
+	else if (soundDeviceInitialized)
+		ma_device_uninit(soundDevice.get());
 
 	ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
 	deviceConfig.playback.format = ma_format_s16;
 	deviceConfig.playback.channels = CHANNELS;
-	deviceConfig.sampleRate = SAMPLE_RATE;
+	deviceConfig.sampleRate = sampleRate;
 	deviceConfig.dataCallback = sound_data_callback;
 	deviceConfig.pUserData = &gb;
 
-	ma_device_init(NULL, &deviceConfig, soundDevice.get());
-	ma_device_start(soundDevice.get());
+	soundDeviceInitialized = ma_device_init(NULL, &deviceConfig, soundDevice.get()) == MA_SUCCESS;
+
+	if (soundDeviceInitialized)
+		ma_device_start(soundDevice.get());
 }
 
-void APU::executeFrameSequencer()
+void APU::setSampleRate(uint32_t rate)
 {
-	frameSequencerCycles++;
+	if (rate == sampleRate)
+		return;
+
+	if (isRecording)
+		stopRecording();
+
+	sampleRate = rate;
+	resampler.setRates(NATIVE_SAMPLE_RATE, rate);
 
+	if (soundDevice != nullptr)
+	{
+#ifdef EMSCRIPTEN
+		initMiniAudio();
+#else
+		std::thread t([this] { initMiniAudio(); });
+		t.detach();
+#endif
+	}
+}
+
+void APU::executeFrameSequencer()
+{
 	if (frameSequencerCycles == 2048)
 	{
 		if ((frameSequencerStep & 1) == 0)
@@ -233,44 +219,305 @@ void APU::executeFrameSequencer()
 	}
 }
 
-void APU::execute(int cycles)
+void APU::execute(uint32_t cycles)
 {
-	while (cycles--)
-	{
-		channel1.execute();
-		channel2.execute();
-		channel3.execute();
-		channel4.execute();
+	const uint8_t nr51 { regs.NR51 };
 
+	// Channels whose output can't change on their frequency timer steps don't need to be stepped individually.
+	const auto audible = [&](int channel) { return captureStems || (synthesizing() && enabledChannels[channel] && (nr51 & (0x11 << channel)) != 0); };
+	const bool routed[4] { audible(0), audible(1), audible(2), audible(3) };
+
+	while (cycles > 0)
+	{
+		uint32_t step { std::min(cycles, 2048u - frameSequencerCycles) };
+
+		if (routed[0] && channel1.s.enabled && channel1.s.amplitude != 0)
+			step = std::min(step, channel1.cyclesUntilStep());
+		if (routed[1] && channel2.s.enabled && channel2.s.amplitude != 0)
+			step = std::min(step, channel2.cyclesUntilStep());
+		if (routed[2] && channel3.s.enabled && (channel3.regs.NR32 & 0b01100000) != 0)
+			step = std::min(step, channel3.cyclesUntilStep());
+		if (routed[3] && channel4.s.enabled && channel4.s.amplitude != 0)
+			step = std::min(step, channel4.cyclesUntilStep());
+
+		channel1.advance(step);
+		channel2.advance(step);
+		channel3.advance(step);
+		channel4.advance(step);
+
+		frameSequencerCycles += step;
 		executeFrameSequencer();
+
+		cycles -= step;
+		blipTime += step;
+		updateOutput();
+	}
+}
+
+void APU::updateMixTable()
+{
+	const uint8_t nr51 { regs.NR51 }, nr50 { regs.NR50 };
+	const uint32_t leftVolume { ((nr50 & 0x70u) >> 4) + 1 }, rightVolume { (nr50 & 0x7u) + 1 };
+
+	for (int channel = 0; channel < 4; channel++)
+	{
+		const uint32_t leftWeight { enabledChannels[channel] * getBit(nr51, channel + 4) * leftVolume };
+		const uint32_t rightWeight { enabledChannels[channel] * getBit(nr51, channel) * rightVolume };
+
+		for (uint32_t sample = 0; sample < 16; sample++)
+			mixTable[channel][sample] = (sample * leftWeight) | ((sample * rightWeight) << 16);
 	}
 }
 
-std::pair<int16_t, int16_t> APU::generateSamples() 
+void APU::updateOutput()
 {
-	float leftSample { 0.f }, rightSample { 0.f };
-	const uint8_t nr51 { regs.NR51.load() };
+	if (!synthesizing())
+		return;
 
-	const float sample1 = (channel1.getSample() / 15.f) * enabledChannels[0], sample2 = (channel2.getSample() / 15.f) * enabledChannels[1],
-				sample3 = (channel3.getSample() / 15.f) * enabledChannels[2], sample4 = (channel4.getSample() / 15.f) * enabledChannels[3];
+	uint32_t mixed { 0 };
 
-	leftSample += sample1 * getBit(nr51, 4);
-	rightSample += sample1 * getBit(nr51, 0);
+	if (enabled())
+	{
+		const auto mixKey { static_cast<uint32_t>(regs.NR50 | (regs.NR51 << 8) | (enabledChannels[0] << 16) | (enabledChannels[1] << 17) | (enabledChannels[2] << 18) | (enabledChannels[3] << 19)) };
 
-	leftSample += sample2 * getBit(nr51, 5);
-	rightSample += sample2 * getBit(nr51, 1);
+		if (mixKey != mixTableKey) [[unlikely]]
+		{
+			mixTableKey = mixKey;
+			updateMixTable();
+		}
 
-	leftSample += sample3 * getBit(nr51, 6);
-	rightSample += sample3 * getBit(nr51, 2);
+		// Both sides are summed at once, neither can carry into the other since the maximum is MAX_AMPLITUDE.
+		mixed = mixTable[0][channel1.getSample()] + mixTable[1][channel2.getSample()] + mixTable[2][channel3.getSample()] + mixTable[3][channel4.getSample()];
+	}
 
-	leftSample += sample4 * getBit(nr51, 7);
-	rightSample += sample4 * getBit(nr51, 3);
+	const int32_t left { static_cast<int32_t>(mixed & 0xFFFF) };
+	const int32_t right { static_cast<int32_t>(mixed >> 16) };
 
-	const uint8_t leftVolume = ((regs.NR50 & 0x70) >> 4) + 1, rightVolume = (regs.NR50 & 0x7) + 1;
-	const float scaleFactor { (volume * INT16_MAX) / 4.0f };
+	if (left != leftAmplitude)
+	{
+		leftBuffer.addDelta(blipTime, left - leftAmplitude);
+		leftAmplitude = left;
+	}
+	if (right != rightAmplitude)
+	{
+		rightBuffer.addDelta(blipTime, right - rightAmplitude);
+		rightAmplitude = right;
+	}
+
+	if (captureStems) [[unlikely]]
+		updateStemOutput();
+}
 
-	leftSample *= scaleFactor * (leftVolume / 8.f);
-	rightSample *= scaleFactor * (rightVolume / 8.f);
+void APU::updateStemOutput()
+{
+	const uint8_t samples[4] { channel1.getSample(), channel2.getSample(), channel3.getSample(), channel4.getSample() };
+
+	for (int i = 0; i < 4; i++)
+	{
+		const int32_t amplitude { enabled() ? samples[i] : 0 };
 
-	return std::make_pair(static_cast<int16_t>(leftSample), static_cast<int16_t>(rightSample));
+		if (amplitude != stemAmplitudes[i])
+		{
+			stemBuffers[i].addDelta(blipTime, amplitude - stemAmplitudes[i]);
+			stemAmplitudes[i] = amplitude;
+		}
+	}
+}
+
+void APU::catchUp()
+{
+	PROFILE_SCOPE(APU);
+
+	// One APU cycle is 4 T-cycles in normal speed mode and 2 CPU M-cycles in double speed mode.
+	uint32_t cycles { pendingCycles / 4 };
+	pendingCycles %= 4;
+
+	// Picks up changes made by register writes since the last catch up.
+	updateOutput();
+
+	while (cycles > 0)
+	{
+		const uint32_t chunk { std::min(cycles, MAX_FRAME_CYCLES - blipTime) };
+
+		if (enabled())
+			execute(chunk);
+		else
+			blipTime += chunk;
+
+		cycles -= chunk;
+
+		if (blipTime == MAX_FRAME_CYCLES)
+			flushSamples();
+	}
+}
+
+void APU::flushSamples()
+{
+	// Buffers are cleared when a capture begins.
+	if (!synthesizing())
+	{
+		blipTime = 0;
+		return;
+	}
+
+	leftBuffer.endFrame(blipTime);
+	rightBuffer.endFrame(blipTime);
+
+	if (captureStems)
+	{
+		for (auto& buffer : stemBuffers)
+			buffer.endFrame(blipTime);
+	}
+
+	blipTime = 0;
+
+	if (blipSpeedFactor != speedFactor)
+	{
+		blipSpeedFactor = speedFactor;
+		leftBuffer.setRates(CPU_FREQUENCY * speedFactor, NATIVE_SAMPLE_RATE);
+		rightBuffer.setRates(CPU_FREQUENCY * speedFactor, NATIVE_SAMPLE_RATE);
+
+		for (auto& buffer : stemBuffers)
+			buffer.setRates(CPU_FREQUENCY * speedFactor, NATIVE_SAMPLE_RATE);
+	}
+
+	const size_t count { leftBuffer.samplesAvailable() };
+	const auto gain { static_cast<int32_t>(volume * INT16_MAX / MAX_AMPLITUDE * 65536) };
+
+	nativeSamples.resize(count * CHANNELS);
+	leftBuffer.readSamples(nativeSamples.data(), count, CHANNELS, gain);
+	rightBuffer.readSamples(nativeSamples.data() + 1, count, CHANNELS, gain);
+
+	if (gb.avRecorder.active()) [[unlikely]]
+		gb.avRecorder.addAudio(nativeSamples.data(), count);
+
+	frameSamples.clear();
+	resampler.process(nativeSamples.data(), count, frameSamples);
+
+	if (capturing) [[unlikely]]
+	{
+		capture.mix.insert(capture.mix.end(), frameSamples.begin(), frameSamples.end());
+
+		if (captureStems)
+			flushStems(count);
+
+		return;
+	}
+
+	const size_t bufferedBeforePush { sampleRing.size() };
+
+	// If the ring is full (audio device stalled or not initialized) the samples are dropped.
+	if (sampleRing.push(frameSamples.data(), frameSamples.size()) != frameSamples.size())
+		overruns++;
+
+	// Fill level jumps by a frame's worth of samples on every push, so the midpoint is used.
+	updateRateControl((bufferedBeforePush + sampleRing.size()) / 2);
+}
+
+void APU::flushStems(size_t count)
+{
+	// Half scale for a full 4 bit step, the high-pass filter can swing the same distance below zero.
+	constexpr int32_t STEM_GAIN { INT16_MAX / (15 * 2) * 65536 };
+
+	for (size_t pair = 0; pair < stemResamplers.size(); pair++)
+	{
+		auto& firstStem { capture.stems[pair * 2] };
+		auto& secondStem { capture.stems[pair * 2 + 1] };
+
+		nativeSamples.resize(count * CHANNELS);
+		stemBuffers[pair * 2].readSamples(nativeSamples.data(), count, CHANNELS, STEM_GAIN);
+		stemBuffers[pair * 2 + 1].readSamples(nativeSamples.data() + 1, count, CHANNELS, STEM_GAIN);
+
+		frameSamples.clear();
+		stemResamplers[pair].process(nativeSamples.data(), count, frameSamples);
+
+		for (size_t i = 0; i < frameSamples.size(); i += CHANNELS)
+		{
+			firstStem.push_back(frameSamples[i]);
+			secondStem.push_back(frameSamples[i + 1]);
+		}
+	}
+}
+
+void APU::beginCapture(bool stems)
+{
+	// Output so far still goes to the audio device.
+	catchUp();
+	flushSamples();
+
+	capture = {};
+	capture.sampleRate = sampleRate;
+	capturing = true;
+	captureStems = stems;
+
+	// All buffers start from the same point, so stems line up with the mix. Rate control stays neutral, there is no device to follow.
+	leftBuffer.clear();
+	rightBuffer.clear();
+	leftAmplitude = rightAmplitude = 0;
+
+	resampler.reset();
+	resampler.setRatioAdjust(1.0);
+
+	for (auto& buffer : stemBuffers)
+	{
+		buffer.setRates(CPU_FREQUENCY * blipSpeedFactor, NATIVE_SAMPLE_RATE);
+		buffer.clear();
+	}
+
+	stemAmplitudes.fill(0);
+
+	for (auto& stemResampler : stemResamplers)
+	{
+		stemResampler.setRates(NATIVE_SAMPLE_RATE, sampleRate);
+		stemResampler.setQuality(resampler.getQuality());
+		stemResampler.reset();
+	}
+
+	updateOutput();
+}
+
+AudioCapture APU::endCapture()
+{
+	catchUp();
+	flushSamples();
+
+	capturing = false;
+	captureStems = false;
+
+	return std::move(capture);
+}
+
+void APU::updateRateControl(size_t bufferedSamples)
+{
+	// Proportional term reacts to jitter, integral term slowly absorbs constant drift between emulation and device clocks.
+	// Both are small enough for the pitch change to be inaudible.
+	constexpr double PROPORTIONAL_GAIN { 0.005 };
+	constexpr double INTEGRAL_GAIN { 0.00002 };
+	constexpr double MAX_ADJUST { 0.01 };
+
+	const double bufferedFrames { static_cast<double>(bufferedSamples / CHANNELS) };
+
+	// Fill level also drops by a device period on every callback, so it's smoothed first.
+	averageBufferedFrames += (bufferedFrames - averageBufferedFrames) * 0.05;
+	bufferedLatency = static_cast<float>(averageBufferedFrames * 1000.0 / sampleRate);
+
+	// Headless, paused or starved: nothing is being consumed, so there's no drift to correct.
+	if (!outputPlaying)
+		return;
+
+	const double targetFrames { static_cast<double>(sampleRate) * targetLatency / 1000.0 };
+	const double error { std::clamp((targetFrames - averageBufferedFrames) / targetFrames, -1.0, 1.0) };
+
+	driftCorrection = std::clamp(driftCorrection + error * INTEGRAL_GAIN, -MAX_ADJUST, MAX_ADJUST);
+	resampler.setRatioAdjust(1.0 + std::clamp(driftCorrection + error * PROPORTIONAL_GAIN, -MAX_ADJUST, MAX_ADJUST));
+}
+
+void APU::endFrame()
+{
+	PROFILE_SCOPE(APU);
+	catchUp();
+	flushSamples();
+#ifndef MEGABOY_HEADLESS
+	recorder.update();
+#endif
 }
\ No newline at end of file
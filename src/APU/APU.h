@@ -5,16 +5,23 @@
 #include <filesystem>
 #include <fstream>
 #include <atomic>
+#include <mutex>
 
 #include "squareWave.h"
 #include "sweepWave.h"
 #include "customWave.h"
 #include "noiseWave.h"
+#include "blipBuffer.h"
+#include "resampler.h"
+#include "audioRecorder.h"
+#include "audioCapture.h"
+#include "../Utils/spscRing.h"
 
+// Registers are only accessed on the emulation thread, MMU writes catch the APU up first, so they don't need to be atomic.
 struct globalAPURegs
 {
-	std::atomic<uint8_t> NR50, NR51;
-	std::atomic<bool> apuEnable; // Instead of NR52, since it is the only writable bit.
+	uint8_t NR50, NR51;
+	bool apuEnable; // Instead of NR52, since it is the only writable bit.
 };
 
 class GBCore;
@@ -30,40 +37,104 @@ public:
 	explicit APU(GBCore& gbCore);
 	~APU();
 
-	void execute(int cycles);
-	std::pair<int16_t, int16_t> generateSamples();
+	// APU is ticked lazily: elapsed cycles are accumulated and executed on register access and at the end of each frame.
+	inline void addCycles(uint8_t tCycles) { pendingCycles += tCycles; }
+	void catchUp();
+	void endFrame();
+
+	// Fast forwarded audio is resampled at speedFactor times the clock rate, so the output rate stays the same.
+	// The new rate is applied at the next frame boundary.
+	constexpr void setSpeedFactor(int factor) { speedFactor = std::max(factor, 1); }
 
 	inline bool enabled() const { return regs.apuEnable; }
 
+	// While capturing, output is collected into an AudioCapture instead of being sent to the audio device.
+	// Stems need every channel stepped individually, so they are only synthesized when requested.
+	void beginCapture(bool captureStems);
+	AudioCapture endCapture();
+
 	void saveState(std::ostream& st) const;
 	void loadState(std::istream& st);
 
 	static constexpr uint32_t CPU_FREQUENCY = 1048576;
-	static constexpr uint32_t SAMPLE_RATE = 48000;
-	static constexpr double CYCLES_PER_SAMPLE = static_cast<double>(CPU_FREQUENCY) / SAMPLE_RATE;
 	static constexpr uint16_t CHANNELS = 2;
 
+	// Channels are synthesized at a fixed native rate, then resampled to the output rate.
+	static constexpr uint32_t NATIVE_SAMPLE_RATE = 65536;
+	static constexpr uint32_t DEFAULT_SAMPLE_RATE = 48000;
+
+	// Restarts the audio device if it's already running. Active recording is stopped.
+	void setSampleRate(uint32_t rate);
+	inline uint32_t getSampleRate() const { return sampleRate; }
+
+	inline void setResamplerQuality(ResamplerQuality quality) { resampler.setQuality(quality); }
+	inline ResamplerQuality getResamplerQuality() const { return resampler.getQuality(); }
+
+	// Output rate multiplier, to compensate for drift between emulation and audio device clocks.
+	// Overridden by dynamic rate control while the audio device is playing.
+	inline void setResampleRatio(double ratio) { resampler.setRatioAdjust(ratio); }
+	inline double getResampleRatio() const { return resampler.getRatioAdjust(); }
+
+	// Dynamic rate control nudges the resample ratio to keep the amount of buffered audio around the target latency.
+	inline void setTargetLatency(int ms) { targetLatency = std::clamp(ms, 10, 150); }
+	inline int getTargetLatency() const { return targetLatency; }
+	inline float getBufferedLatency() const { return bufferedLatency; }
+
+	inline void resetAudioStats() { underruns = 0; overruns = 0; }
+
+	std::atomic<uint32_t> underruns { 0 }; // Times the audio device ran out of samples while playing.
+	std::atomic<uint32_t> overruns { 0 }; // Times produced samples were dropped because the ring was full.
+
+	std::atomic<int> targetLatency { 40 }; // In milliseconds.
+	std::atomic<bool> outputPlaying { false }; // Set by the audio callback once the target latency is buffered.
+
+	// Interleaved stereo samples, produced on the emulation thread and drained by the audio callback.
+	SPSCRing<int16_t, 32768> sampleRing;
+
 	std::atomic<float> volume { 0.5 };
-	std::array<std::atomic<bool>, 4> enabledChannels { true, true, true, true };
+	std::array<bool, 4> enabledChannels { true, true, true, true };
 
 	std::atomic<bool> isRecording { false };
-	std::atomic<float> recordedSeconds { 0.f };
-
-	static inline std::atomic<bool> isMainThreadBlocked { false };
-	static inline std::atomic<double> lastMainThreadTime { 0.0 };
 
-	void startRecording(const std::filesystem::path& filePath);
+	// Recording is only started if the file could be created.
+	bool startRecording(const std::filesystem::path& filePath, RecordingFormat format = RecordingFormat::WAV);
 	void stopRecording();
 
-	std::ofstream recordingStream;
-	std::vector<int16_t> recordingBuffer;
+	inline float getRecordedSeconds() const { return recorder.recordedSeconds(); }
+
+	AudioRecorder recorder;
 private:
+	void execute(uint32_t cycles);
 	void executeFrameSequencer();
+	void updateMixTable();
+	void updateOutput();
+	void updateStemOutput();
+	void flushSamples();
+	void flushStems(size_t count);
+	void updateRateControl(size_t bufferedSamples);
 	void initMiniAudio();
-	void writeWAVHeader();
+
+	// Headless builds have no device to play samples, so they are only synthesized while capturing.
+	inline bool synthesizing() const
+	{
+#ifdef MEGABOY_HEADLESS
+		return capturing;
+#else
+		return true;
+#endif
+	}
 
 	typedef class ma_device ma_device;
 	std::unique_ptr<ma_device> soundDevice;
+	std::mutex soundDeviceMutex;
+	bool soundDeviceInitialized { false };
+
+	std::atomic<uint32_t> sampleRate { DEFAULT_SAMPLE_RATE };
+	Resampler resampler;
+
+	std::atomic<float> bufferedLatency { 0.f };
+	double averageBufferedFrames{};
+	double driftCorrection{};
 
 	GBCore& gb;
 
@@ -97,4 +168,32 @@ private:
 
 	uint16_t frameSequencerCycles{};
 	uint8_t frameSequencerStep{};
+
+	uint32_t pendingCycles{};
+	int speedFactor { 1 };
+
+	// Output is synthesized by adding amplitude deltas at the cycle they happen, instead of point sampling every sample period.
+	static constexpr uint32_t MAX_FRAME_CYCLES = 32768;
+	static constexpr int32_t MAX_AMPLITUDE = 4 * 15 * 8; // 4 channels, 4 bit samples, 3 bit master volume + 1.
+
+	BlipBuffer leftBuffer, rightBuffer;
+	uint32_t blipTime{};
+	int blipSpeedFactor{};
+	int32_t leftAmplitude{}, rightAmplitude{};
+
+	// Left (low 16 bits) and right (high 16 bits) amplitude of each channel sample, for the current panning, master volume and muting.
+	std::array<std::array<uint32_t, 16>, 4> mixTable{};
+	uint32_t mixTableKey { UINT32_MAX };
+
+	std::vector<int16_t> nativeSamples;
+	std::vector<int16_t> frameSamples;
+
+	bool capturing { false };
+	bool captureStems { false };
+	AudioCapture capture;
+
+	// Stems use the same blip and resampler settings as the mix, two channels per stereo resampler.
+	std::array<BlipBuffer, 4> stemBuffers;
+	std::array<int32_t, 4> stemAmplitudes{};
+	std::array<Resampler, 2> stemResamplers;
 };
\ No newline at end of file
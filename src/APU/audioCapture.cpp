@@ -0,0 +1,42 @@
+#include <fstream>
+#include <string>
+#include "audioCapture.h"
+#include "wavFile.h"
+
+namespace
+{
+	bool writeWAV(const std::filesystem::path& path, const std::vector<int16_t>& samples, uint32_t sampleRate, uint16_t channels)
+	{
+		std::ofstream st { path, std::ios::binary };
+
+		if (!st)
+			return false;
+
+		WAVFile::writeHeader(st, sampleRate, channels);
+		st.write(reinterpret_cast<const char*>(samples.data()), static_cast<std::streamsize>(samples.size() * sizeof(int16_t)));
+		WAVFile::finalize(st);
+
+		return static_cast<bool>(st);
+	}
+}
+
+bool AudioCapture::saveWAV(const std::filesystem::path& mixPath) const
+{
+	if (!writeWAV(mixPath, mix, sampleRate, 2))
+		return false;
+
+	for (size_t i = 0; i < stems.size(); i++)
+	{
+		if (stems[i].empty())
+			continue;
+
+		std::filesystem::path stemPath { mixPath };
+		stemPath.replace_extension();
+		stemPath += "_ch" + std::to_string(i + 1) + ".wav";
+
+		if (!writeWAV(stemPath, stems[i], sampleRate, 1))
+			return false;
+	}
+
+	return true;
+}
\ No newline at end of file
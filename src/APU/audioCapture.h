@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <filesystem>
+
+// Audio rendered offline, see GBCore::renderAudio. Stems line up sample for sample with the mix.
+struct AudioCapture
+{
+	uint32_t sampleRate{};
+
+	std::vector<int16_t> mix; // Interleaved stereo, same as the audio device output.
+	std::array<std::vector<int16_t>, 4> stems; // Mono output of each channel, before panning, master volume and muting.
+
+	// Writes the mix to the given path, and the stems next to it with a _ch1 - _ch4 suffix.
+	bool saveWAV(const std::filesystem::path& mixPath) const;
+};
\ No newline at end of file
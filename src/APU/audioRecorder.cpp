@@ -0,0 +1,147 @@
+#include <chrono>
+#include "audioRecorder.h"
+#include "wavFile.h"
+
+bool AudioRecorder::start(const std::filesystem::path& filePath, uint32_t rate, RecordingFormat newFormat)
+{
+	stop();
+
+	stream = std::ofstream { filePath, std::ios::binary };
+
+	if (!stream)
+		return false;
+
+	format = newFormat;
+	sampleRate = rate;
+
+	// Nothing is pushed while not recording, so this thread is the only consumer for now.
+	ring.clear();
+	chunk.clear();
+	recordedFrames = 0;
+	encodedFrames = 0;
+	droppedSamples = 0;
+
+	if (format == RecordingFormat::FLAC)
+	{
+		flacEncoder.reset();
+		FlacEncoder::writeStreamHeader(stream, sampleRate);
+	}
+	else
+		WAVFile::writeHeader(stream, sampleRate, CHANNELS);
+
+	stopRequested = false;
+	recording = true;
+
+#ifndef EMSCRIPTEN
+	writerThread = std::thread { &AudioRecorder::writerLoop, this };
+#endif
+	return true;
+}
+
+void AudioRecorder::stop()
+{
+	if (!recording)
+		return;
+
+	recording = false;
+
+#ifdef EMSCRIPTEN
+	drain();
+	finalize();
+#else
+	stopRequested = true;
+	writerThread.join();
+#endif
+}
+
+void AudioRecorder::update()
+{
+#ifdef EMSCRIPTEN
+	if (recording)
+		drain();
+#endif
+}
+
+void AudioRecorder::writerLoop()
+{
+	while (true)
+	{
+		// Checked before draining, so samples pushed before the stop request are always written.
+		const bool stopping { stopRequested };
+
+		if (!drain())
+		{
+			if (stopping)
+				break;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+
+	finalize();
+}
+
+bool AudioRecorder::drain()
+{
+	bool drained { false };
+
+	if (format == RecordingFormat::WAV)
+	{
+		chunk.resize(CHUNK_SIZE);
+
+		while (const size_t count { ring.pop(chunk.data(), CHUNK_SIZE) })
+		{
+			stream.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(count * sizeof(int16_t)));
+			encodedFrames += count / CHANNELS;
+			drained = true;
+		}
+
+		return drained;
+	}
+
+	constexpr size_t BLOCK_SAMPLES { FlacEncoder::BLOCK_SIZE * CHANNELS };
+
+	while (true)
+	{
+		const size_t filled { chunk.size() };
+		chunk.resize(BLOCK_SAMPLES);
+
+		const size_t count { ring.pop(chunk.data() + filled, BLOCK_SAMPLES - filled) };
+		chunk.resize(filled + count);
+
+		if (count == 0)
+			break;
+
+		drained = true;
+
+		if (chunk.size() == BLOCK_SAMPLES)
+		{
+			flacEncoder.encodeFrame(stream, chunk.data(), FlacEncoder::BLOCK_SIZE);
+			encodedFrames += FlacEncoder::BLOCK_SIZE;
+			chunk.clear();
+		}
+	}
+
+	return drained;
+}
+
+void AudioRecorder::finalize()
+{
+	if (format == RecordingFormat::FLAC)
+	{
+		// Last block is shorter.
+		if (!chunk.empty())
+		{
+			const uint32_t frames { static_cast<uint32_t>(chunk.size() / CHANNELS) };
+			flacEncoder.encodeFrame(stream, chunk.data(), frames);
+			encodedFrames += frames;
+			chunk.clear();
+		}
+
+		FlacEncoder::finalizeStream(stream, sampleRate, encodedFrames);
+	}
+	else
+		WAVFile::finalize(stream);
+
+	stream.close();
+}
\ No newline at end of file
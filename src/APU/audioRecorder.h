@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <thread>
+
+#include "flacEncoder.h"
+#include "../Utils/spscRing.h"
+
+enum class RecordingFormat : uint8_t
+{
+	WAV,
+	FLAC
+};
+
+// Records interleaved stereo 16 bit samples. write() is safe to call from the audio callback: it only copies into a preallocated ring,
+// encoding and file I/O happen on a background writer thread.
+class AudioRecorder
+{
+public:
+	~AudioRecorder() { stop(); }
+
+	bool start(const std::filesystem::path& filePath, uint32_t sampleRate, RecordingFormat format);
+	void stop();
+
+	// Producer side. Samples that don't fit in the ring are dropped.
+	inline void write(const int16_t* samples, size_t count)
+	{
+		const size_t written { ring.push(samples, count) };
+		recordedFrames += written / CHANNELS;
+
+		if (written != count) [[unlikely]]
+			droppedSamples += static_cast<uint32_t>(count - written);
+	}
+
+	// Without threads, the ring is drained here instead, outside of the audio callback.
+	void update();
+
+	inline bool active() const { return recording; }
+	inline float recordedSeconds() const { return static_cast<float>(recordedFrames) / sampleRate; }
+	inline uint32_t getDroppedSamples() const { return droppedSamples; }
+private:
+	void writerLoop();
+	bool drain();
+	void finalize();
+
+	static constexpr uint16_t CHANNELS = 2;
+	static constexpr size_t CHUNK_SIZE = 4096;
+
+	SPSCRing<int16_t, 1 << 18> ring; // About 2.7 seconds at 48 kHz, enough to ride out slow disk writes.
+	std::vector<int16_t> chunk; // Pending FLAC block, or a scratch buffer for WAV.
+
+	std::ofstream stream;
+	FlacEncoder flacEncoder;
+	RecordingFormat format { RecordingFormat::WAV };
+	uint32_t sampleRate { 1 };
+
+	std::thread writerThread;
+	std::atomic<bool> stopRequested { false };
+	std::atomic<bool> recording { false };
+
+	std::atomic<uint64_t> recordedFrames { 0 };
+	uint64_t encodedFrames{}; // Only accessed by the writer.
+	std::atomic<uint32_t> droppedSamples { 0 };
+};
\ No newline at end of file
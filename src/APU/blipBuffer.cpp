@@ -0,0 +1,95 @@
+#include <cmath>
+#include <algorithm>
+#include "blipBuffer.h"
+
+namespace
+{
+	constexpr size_t BUFFER_SIZE = 8192;
+
+	auto generateKernel()
+	{
+		constexpr int PHASES { 64 };
+		constexpr int HALF_WIDTH { BlipBuffer::KERNEL_WIDTH / 2 };
+		constexpr double CUTOFF { 0.9 }; // Relative to nyquist frequency.
+		constexpr double PI { 3.14159265358979323846 };
+
+		std::array<std::array<int32_t, BlipBuffer::KERNEL_WIDTH>, PHASES> kernel{};
+
+		for (int phase = 0; phase < PHASES; phase++)
+		{
+			std::array<double, BlipBuffer::KERNEL_WIDTH> taps{};
+			double sum { 0.0 };
+
+			for (int i = 0; i < BlipBuffer::KERNEL_WIDTH; i++)
+			{
+				// Distance of the tap from the step position, in samples.
+				const double x { i - (HALF_WIDTH - 1) - static_cast<double>(phase) / PHASES };
+				const double sinc { x == 0.0 ? CUTOFF : std::sin(PI * CUTOFF * x) / (PI * x) };
+				const double window { 0.42 + 0.5 * std::cos(PI * x / HALF_WIDTH) + 0.08 * std::cos(2 * PI * x / HALF_WIDTH) }; // Blackman
+
+				taps[i] = sinc * window;
+				sum += taps[i];
+			}
+
+			// Each phase must add up exactly to one unit, otherwise rounding errors would accumulate as DC offset.
+			int32_t intSum { 0 };
+
+			for (int i = 0; i < BlipBuffer::KERNEL_WIDTH; i++)
+			{
+				kernel[phase][i] = static_cast<int32_t>(std::lround(taps[i] / sum * (1 << BlipBuffer::DELTA_BITS)));
+				intSum += kernel[phase][i];
+			}
+
+			const auto peak { std::max_element(kernel[phase].begin(), kernel[phase].end()) };
+			*peak += (1 << BlipBuffer::DELTA_BITS) - intSum;
+		}
+
+		return kernel;
+	}
+}
+
+const std::array<std::array<int32_t, BlipBuffer::KERNEL_WIDTH>, BlipBuffer::PHASES> BlipBuffer::KERNEL { generateKernel() };
+
+BlipBuffer::BlipBuffer() : buffer(BUFFER_SIZE + KERNEL_WIDTH)
+{}
+
+void BlipBuffer::setRates(uint32_t clockRate, uint32_t sampleRate)
+{
+	factor = (static_cast<uint64_t>(sampleRate) << FRAC_BITS) / clockRate;
+}
+
+void BlipBuffer::clear()
+{
+	offset = 0;
+	avail = 0;
+	integrator = 0;
+	std::fill(buffer.begin(), buffer.end(), 0);
+}
+
+void BlipBuffer::endFrame(uint32_t clocks)
+{
+	offset += clocks * factor;
+	avail = std::min(avail + static_cast<size_t>(offset >> FRAC_BITS), BUFFER_SIZE);
+	offset &= (1ULL << FRAC_BITS) - 1;
+}
+
+void BlipBuffer::readSamples(int16_t* out, size_t count, size_t stride, int32_t gain)
+{
+	count = std::min(count, avail);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		integrator += buffer[i];
+		const int64_t sample { integrator >> (DELTA_BITS - OUTPUT_FRAC_BITS) };
+		integrator -= integrator >> BASS_SHIFT;
+
+		out[i * stride] = static_cast<int16_t>(std::clamp<int64_t>((sample * gain) >> (16 + OUTPUT_FRAC_BITS), INT16_MIN, INT16_MAX));
+	}
+
+	// Move the not yet complete samples to the start.
+	const size_t remaining { avail - count + KERNEL_WIDTH };
+	std::copy_n(buffer.begin() + count, remaining, buffer.begin());
+	std::fill_n(buffer.begin() + remaining, count, 0);
+
+	avail -= count;
+}
\ No newline at end of file
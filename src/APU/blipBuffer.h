@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <vector>
+
+// Band-limited step buffer. Amplitude changes are added as deltas at clock timestamps,
+// and converted to output samples through a windowed sinc step response (same idea as blip_buf).
+class BlipBuffer
+{
+public:
+	BlipBuffer();
+
+	void setRates(uint32_t clockRate, uint32_t sampleRate);
+	void clear();
+
+	// Time is in clocks relative to the start of the current frame.
+	inline void addDelta(uint32_t time, int32_t delta)
+	{
+		const uint64_t pos { offset + time * factor };
+		const auto& kernel { KERNEL[(pos >> (FRAC_BITS - PHASE_BITS)) & (PHASES - 1)] };
+		int32_t* out { &buffer[avail + static_cast<size_t>(pos >> FRAC_BITS)] };
+
+		for (int i = 0; i < KERNEL_WIDTH; i++)
+			out[i] += kernel[i] * delta;
+	}
+
+	// Makes samples up to the given clock time available for reading, and starts a new frame there.
+	void endFrame(uint32_t clocks);
+
+	inline size_t samplesAvailable() const { return avail; }
+
+	// Writes count samples spaced by stride, scaled by gain (16.16 fixed point) and clamped to 16 bits.
+	void readSamples(int16_t* out, size_t count, size_t stride, int32_t gain);
+
+	static constexpr int DELTA_BITS = 15;
+	static constexpr int KERNEL_WIDTH = 16;
+private:
+	static constexpr int FRAC_BITS = 32;
+	static constexpr int PHASE_BITS = 6;
+	static constexpr int PHASES = 1 << PHASE_BITS;
+
+	// Filtered output keeps this many fractional bits of amplitude before gain is applied.
+	static constexpr int OUTPUT_FRAC_BITS = 6;
+	static constexpr int BASS_SHIFT = 9; // DC blocking high-pass, ~20 Hz at the 65536 Hz output rate.
+
+	static const std::array<std::array<int32_t, KERNEL_WIDTH>, PHASES> KERNEL;
+
+	uint64_t factor{}; // Output samples per clock, 32.32 fixed point.
+	uint64_t offset{}; // Fractional sample position of the current frame start.
+	size_t avail{};
+	int64_t integrator{};
+
+	std::vector<int32_t> buffer;
+};
\ No newline at end of file
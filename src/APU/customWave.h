@@ -2,13 +2,12 @@
 
 #include <array>
 #include <cstdint>
-#include <atomic>
 
 #include "../defines.h"
 
 struct customWaveRegs
 {
-	std::atomic<uint8_t> NR30, NR31, NR32, NR33, NR34;
+	uint8_t NR30, NR31, NR32, NR33, NR34;
 };
 
 struct customWaveState
@@ -37,7 +36,7 @@ struct customWave
 		return regs.NR33 | ((regs.NR34 & 0b111) << 8);
 	}
 
-	inline bool dacEnabled() const { return getBit(regs.NR30.load(), 7); }
+	inline bool dacEnabled() const { return getBit(regs.NR30, 7); }
 
 	inline uint8_t getVolumeShift() const
 	{
@@ -64,7 +63,7 @@ struct customWave
 
 	inline void executeLength()
 	{
-		if (!getBit(regs.NR34.load(), 6) || s.lengthTimer == 0) 
+		if (!getBit(regs.NR34, 6) || s.lengthTimer == 0) 
 			return;
 
 		s.lengthTimer--;
@@ -73,15 +72,24 @@ struct customWave
 			s.enabled = false;
 	}
 
-	inline void execute()
+	inline uint32_t cyclesUntilStep() const { return s.freqPeriodTimer + 1u; }
+
+	inline void advance(uint32_t cycles)
 	{
-		if (s.freqPeriodTimer == 0)
+		if (cycles <= s.freqPeriodTimer)
 		{
-			s.freqPeriodTimer = (2048 - getFrequency()) >> 1;
-			s.sampleInd = (s.sampleInd + 1) & 31;
+			s.freqPeriodTimer -= cycles;
+			return;
 		}
 
-		s.freqPeriodTimer--;
+		cycles -= s.freqPeriodTimer + 1u;
+
+		// Period of 0 (frequency 2047) makes the 16 bit timer wrap around.
+		const uint16_t reload = (2048 - getFrequency()) >> 1;
+		const uint32_t period { reload == 0 ? 0x10000u : reload };
+
+		s.sampleInd = (s.sampleInd + 1 + cycles / period) & 31;
+		s.freqPeriodTimer = static_cast<uint16_t>(period - 1 - cycles % period);
 	}
 
 	inline uint8_t getCurrentWaveByte() const
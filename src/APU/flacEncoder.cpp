@@ -0,0 +1,346 @@
+#include <algorithm>
+#include "flacEncoder.h"
+
+namespace
+{
+	constexpr int SAMPLE_BITS = 16;
+	constexpr int MAX_FIXED_ORDER = 4;
+	constexpr int MAX_PARTITION_ORDER = 6;
+	constexpr int MAX_RICE_PARAM = 14; // 15 is the escape code with 4 bit parameters.
+
+	constexpr uint8_t CHANNELS_INDEPENDENT = 0b0001;
+	constexpr uint8_t CHANNELS_LEFT_SIDE = 0b1000;
+	constexpr uint8_t CHANNELS_RIGHT_SIDE = 0b1001;
+	constexpr uint8_t CHANNELS_MID_SIDE = 0b1010;
+
+	constexpr size_t STREAMINFO_OFFSET = 8; // After "fLaC" and the metadata block header.
+
+	uint8_t crc8(const uint8_t* data, size_t len)
+	{
+		uint8_t crc { 0 };
+
+		for (size_t i = 0; i < len; i++)
+		{
+			crc ^= data[i];
+
+			for (int bit = 0; bit < 8; bit++)
+				crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+		}
+
+		return crc;
+	}
+
+	uint16_t crc16(const uint8_t* data, size_t len)
+	{
+		uint16_t crc { 0 };
+
+		for (size_t i = 0; i < len; i++)
+		{
+			crc ^= static_cast<uint16_t>(data[i] << 8);
+
+			for (int bit = 0; bit < 8; bit++)
+				crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1);
+		}
+
+		return crc;
+	}
+
+	// Estimated Rice coded size of a partition, same estimate libFLAC uses to pick the parameter.
+	inline uint64_t riceBits(uint64_t sum, uint32_t count, int param)
+	{
+		return static_cast<uint64_t>(count) * (param + 1) + (sum >> param);
+	}
+
+	inline int bestRiceParam(uint64_t sum, uint32_t count)
+	{
+		int best { 0 };
+
+		for (int param = 1; param <= MAX_RICE_PARAM; param++)
+		{
+			if (riceBits(sum, count, param) < riceBits(sum, count, best))
+				best = param;
+		}
+
+		return best;
+	}
+
+	// Sample rate, channels and bits per sample share the bytes with the total sample count.
+	void writeStreamParams(std::ostream& st, uint32_t sampleRate, uint64_t totalFrames)
+	{
+		const uint64_t packed { (static_cast<uint64_t>(sampleRate) << 44) | (1ULL << 41) | (static_cast<uint64_t>(SAMPLE_BITS - 1) << 36) | (totalFrames & 0xFFFFFFFFFULL) };
+
+		for (int i = 7; i >= 0; i--)
+			st.put(static_cast<char>((packed >> (i * 8)) & 0xFF));
+	}
+}
+
+void FlacEncoder::writeStreamHeader(std::ostream& st, uint32_t sampleRate)
+{
+	constexpr uint32_t STREAMINFO_LENGTH = 34;
+
+	st.write("fLaC", 4);
+
+	// Last metadata block flag + STREAMINFO type, then 24 bit length.
+	st.put(static_cast<char>(0x80));
+	st.put(0);
+	st.put(0);
+	st.put(static_cast<char>(STREAMINFO_LENGTH));
+
+	// Min and max block size, the last block may be shorter.
+	for (int i = 0; i < 2; i++)
+	{
+		st.put(static_cast<char>(BLOCK_SIZE >> 8));
+		st.put(static_cast<char>(BLOCK_SIZE & 0xFF));
+	}
+
+	// Min and max frame size (unknown).
+	for (int i = 0; i < 6; i++)
+		st.put(0);
+
+	writeStreamParams(st, sampleRate, 0);
+
+	// MD5 signature of the audio data (unknown).
+	for (int i = 0; i < 16; i++)
+		st.put(0);
+}
+
+void FlacEncoder::finalizeStream(std::ostream& st, uint32_t sampleRate, uint64_t totalFrames)
+{
+	st.seekp(STREAMINFO_OFFSET + 10, std::ios::beg);
+	writeStreamParams(st, sampleRate, totalFrames);
+}
+
+void FlacEncoder::computeResiduals(const std::vector<int32_t>& samples, int order)
+{
+	residuals.resize(samples.size() - order);
+
+	for (size_t i = order; i < samples.size(); i++)
+	{
+		int32_t residual;
+
+		switch (order)
+		{
+		case 0: residual = samples[i]; break;
+		case 1: residual = samples[i] - samples[i - 1]; break;
+		case 2: residual = samples[i] - 2 * samples[i - 1] + samples[i - 2]; break;
+		case 3: residual = samples[i] - 3 * samples[i - 1] + 3 * samples[i - 2] - samples[i - 3]; break;
+		default: residual = samples[i] - 4 * samples[i - 1] + 6 * samples[i - 2] - 4 * samples[i - 3] + samples[i - 4]; break;
+		}
+
+		residuals[i - order] = (static_cast<uint32_t>(residual) << 1) ^ static_cast<uint32_t>(residual >> 31);
+	}
+}
+
+FlacEncoder::subframePlan FlacEncoder::planSubframe(const std::vector<int32_t>& samples, int bps)
+{
+	const uint32_t blockSize { static_cast<uint32_t>(samples.size()) };
+	subframePlan plan{};
+
+	if (std::all_of(samples.begin(), samples.end(), [&](int32_t sample) { return sample == samples[0]; }))
+	{
+		plan.constant = true;
+		plan.bits = 8 + bps;
+		return plan;
+	}
+
+	plan.verbatim = true;
+	plan.bits = 8 + static_cast<uint64_t>(blockSize) * bps;
+
+	for (int order = 0; order <= MAX_FIXED_ORDER && static_cast<uint32_t>(order) < blockSize; order++)
+	{
+		computeResiduals(samples, order);
+
+		// Finest partition order where the block still splits evenly, and the first partition is longer than the warm-up.
+		int maxPartitionOrder { 0 };
+
+		while (maxPartitionOrder < MAX_PARTITION_ORDER && (blockSize % (2u << maxPartitionOrder)) == 0 && (blockSize >> (maxPartitionOrder + 1)) > static_cast<uint32_t>(order))
+			maxPartitionOrder++;
+
+		// Sums at the finest order, merged pairwise for coarser ones.
+		std::array<uint64_t, 1 << MAX_PARTITION_ORDER> sums{};
+		const uint32_t finestSize { blockSize >> maxPartitionOrder };
+
+		for (uint32_t i = 0; i < blockSize - order; i++)
+			sums[(i + order) / finestSize] += residuals[i];
+
+		for (int partitionOrder = maxPartitionOrder; partitionOrder >= 0; partitionOrder--)
+		{
+			const uint32_t partitions { 1u << partitionOrder };
+			const uint32_t partitionSize { blockSize >> partitionOrder };
+
+			uint64_t bits { 8 + static_cast<uint64_t>(order) * bps + 2 + 4 };
+			std::array<int, 64> params{};
+
+			for (uint32_t p = 0; p < partitions; p++)
+			{
+				const uint32_t count { p == 0 ? partitionSize - order : partitionSize };
+				params[p] = bestRiceParam(sums[p], count);
+				bits += 4 + riceBits(sums[p], count, params[p]);
+			}
+
+			if (bits < plan.bits)
+			{
+				plan = {};
+				plan.bits = bits;
+				plan.order = order;
+				plan.partitionOrder = partitionOrder;
+				plan.riceParams = params;
+			}
+
+			for (uint32_t p = 0; p < partitions / 2; p++)
+				sums[p] = sums[p * 2] + sums[p * 2 + 1];
+		}
+	}
+
+	return plan;
+}
+
+void FlacEncoder::writeSubframe(const std::vector<int32_t>& samples, int bps, const subframePlan& plan)
+{
+	const uint32_t mask { (1u << bps) - 1 };
+
+	if (plan.constant)
+	{
+		writer.write(0b00000000, 8);
+		writer.write(static_cast<uint32_t>(samples[0]) & mask, bps);
+		return;
+	}
+
+	if (plan.verbatim)
+	{
+		writer.write(0b00000010, 8);
+
+		for (const int32_t sample : samples)
+			writer.write(static_cast<uint32_t>(sample) & mask, bps);
+
+		return;
+	}
+
+	writer.write((0b001000 | plan.order) << 1, 8);
+
+	for (int i = 0; i < plan.order; i++)
+		writer.write(static_cast<uint32_t>(samples[i]) & mask, bps);
+
+	computeResiduals(samples, plan.order);
+
+	writer.write(0b00, 2); // Rice coding with 4 bit parameters.
+	writer.write(static_cast<uint32_t>(plan.partitionOrder), 4);
+
+	const uint32_t partitionSize { static_cast<uint32_t>(samples.size()) >> plan.partitionOrder };
+	size_t residualInd { 0 };
+
+	for (uint32_t p = 0; p < (1u << plan.partitionOrder); p++)
+	{
+		const int param { plan.riceParams[p] };
+		const uint32_t count { p == 0 ? partitionSize - plan.order : partitionSize };
+
+		writer.write(static_cast<uint32_t>(param), 4);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const uint32_t val { residuals[residualInd++] };
+
+			for (uint32_t quotient = val >> param; quotient > 0; quotient--)
+				writer.writeBit(0);
+
+			writer.writeBit(1);
+			writer.write(val & ((1u << param) - 1), param);
+		}
+	}
+}
+
+void FlacEncoder::encodeFrame(std::ostream& st, const int16_t* samples, uint32_t frames)
+{
+	left.resize(frames);
+	right.resize(frames);
+	mid.resize(frames);
+	side.resize(frames);
+
+	for (uint32_t i = 0; i < frames; i++)
+	{
+		left[i] = samples[i * 2];
+		right[i] = samples[i * 2 + 1];
+		mid[i] = (left[i] + right[i]) >> 1;
+		side[i] = left[i] - right[i];
+	}
+
+	const subframePlan leftPlan { planSubframe(left, SAMPLE_BITS) };
+	const subframePlan rightPlan { planSubframe(right, SAMPLE_BITS) };
+	const subframePlan midPlan { planSubframe(mid, SAMPLE_BITS) };
+	const subframePlan sidePlan { planSubframe(side, SAMPLE_BITS + 1) }; // Side channel needs an extra bit.
+
+	uint8_t assignment { CHANNELS_INDEPENDENT };
+	uint64_t bestBits { leftPlan.bits + rightPlan.bits };
+
+	const auto tryAssignment = [&](uint8_t channels, uint64_t bits)
+	{
+		if (bits < bestBits)
+		{
+			assignment = channels;
+			bestBits = bits;
+		}
+	};
+
+	tryAssignment(CHANNELS_LEFT_SIDE, leftPlan.bits + sidePlan.bits);
+	tryAssignment(CHANNELS_RIGHT_SIDE, sidePlan.bits + rightPlan.bits);
+	tryAssignment(CHANNELS_MID_SIDE, midPlan.bits + sidePlan.bits);
+
+	writer.clear();
+
+	// Frame header: sync code with fixed block size strategy, block size, sample rate from STREAMINFO.
+	writer.write(0xFFF8, 16);
+	writer.write(frames == BLOCK_SIZE ? 0b1100 : 0b0111, 4);
+	writer.write(0b0000, 4);
+	writer.write(assignment, 4);
+	writer.write(0b100, 3); // 16 bits per sample.
+	writer.writeBit(0);
+
+	// Frame number, UTF-8 style variable length coding.
+	if (frameNumber < 0x80)
+		writer.write(static_cast<uint32_t>(frameNumber), 8);
+	else
+	{
+		int extraBytes { 1 };
+
+		while (extraBytes < 5 && frameNumber >= (1ULL << (6 + 5 * extraBytes)))
+			extraBytes++;
+
+		writer.write(((0xFF00u >> (extraBytes + 1)) & 0xFF) | static_cast<uint32_t>(frameNumber >> (6 * extraBytes)), 8);
+
+		for (int i = extraBytes - 1; i >= 0; i--)
+			writer.write(0x80 | static_cast<uint32_t>((frameNumber >> (6 * i)) & 0x3F), 8);
+	}
+
+	if (frames != BLOCK_SIZE)
+		writer.write(frames - 1, 16);
+
+	writer.write(crc8(writer.bytes.data(), writer.bytes.size()), 8);
+
+	switch (assignment)
+	{
+	case CHANNELS_INDEPENDENT:
+		writeSubframe(left, SAMPLE_BITS, leftPlan);
+		writeSubframe(right, SAMPLE_BITS, rightPlan);
+		break;
+	case CHANNELS_LEFT_SIDE:
+		writeSubframe(left, SAMPLE_BITS, leftPlan);
+		writeSubframe(side, SAMPLE_BITS + 1, sidePlan);
+		break;
+	case CHANNELS_RIGHT_SIDE:
+		writeSubframe(side, SAMPLE_BITS + 1, sidePlan);
+		writeSubframe(right, SAMPLE_BITS, rightPlan);
+		break;
+	case CHANNELS_MID_SIDE:
+		writeSubframe(mid, SAMPLE_BITS, midPlan);
+		writeSubframe(side, SAMPLE_BITS + 1, sidePlan);
+		break;
+	}
+
+	writer.alignToByte();
+
+	const uint16_t crc { crc16(writer.bytes.data(), writer.bytes.size()) };
+	writer.write(crc, 16);
+
+	st.write(reinterpret_cast<const char*>(writer.bytes.data()), static_cast<std::streamsize>(writer.bytes.size()));
+	frameNumber++;
+}
\ No newline at end of file
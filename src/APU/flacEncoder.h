@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <ostream>
+
+// Minimal FLAC encoder for 16 bit stereo: fixed linear predictors (order 0-4) with partitioned Rice coded residuals,
+// and the best of independent, left/side, right/side or mid/side channel decorrelation per frame.
+class FlacEncoder
+{
+public:
+	static constexpr uint32_t BLOCK_SIZE = 4096;
+
+	static void writeStreamHeader(std::ostream& st, uint32_t sampleRate);
+
+	// Total sample count in the STREAMINFO block is only known at the end.
+	static void finalizeStream(std::ostream& st, uint32_t sampleRate, uint64_t totalFrames);
+
+	// Encodes up to BLOCK_SIZE interleaved stereo frames as one FLAC frame.
+	void encodeFrame(std::ostream& st, const int16_t* samples, uint32_t frames);
+
+	void reset() { frameNumber = 0; }
+private:
+	class BitWriter
+	{
+	public:
+		inline void write(uint32_t val, int bits)
+		{
+			for (int i = bits - 1; i >= 0; i--)
+				writeBit((val >> i) & 1);
+		}
+
+		inline void writeBit(uint32_t bit)
+		{
+			current = static_cast<uint8_t>((current << 1) | bit);
+
+			if (++bitCount == 8)
+			{
+				bytes.push_back(current);
+				current = 0;
+				bitCount = 0;
+			}
+		}
+
+		inline void alignToByte()
+		{
+			while (bitCount != 0)
+				writeBit(0);
+		}
+
+		inline void clear()
+		{
+			bytes.clear();
+			current = 0;
+			bitCount = 0;
+		}
+
+		std::vector<uint8_t> bytes;
+	private:
+		uint8_t current{};
+		int bitCount{};
+	};
+
+	struct subframePlan
+	{
+		uint64_t bits{};
+		bool constant{}, verbatim{};
+		int order{}, partitionOrder{};
+		std::array<int, 64> riceParams{};
+	};
+
+	subframePlan planSubframe(const std::vector<int32_t>& samples, int bps);
+	void writeSubframe(const std::vector<int32_t>& samples, int bps, const subframePlan& plan);
+
+	void computeResiduals(const std::vector<int32_t>& samples, int order);
+
+	BitWriter writer;
+	uint64_t frameNumber{};
+
+	std::vector<int32_t> left, right, mid, side;
+	std::vector<uint32_t> residuals; // Zigzag folded.
+};
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "noiseWave.h"
+
+namespace
+{
+	constexpr uint32_t PERIOD_15 = 32767;
+	constexpr uint32_t PERIOD_7 = 127;
+
+	// After 8 shifts in 7 bit mode, the upper bits are fully determined by the low 7 bits, which cycle on their own.
+	constexpr uint32_t SETTLE_SHIFTS_7 = 8;
+
+	struct LFSRTables
+	{
+		std::array<uint16_t, PERIOD_15> sequence15; // State after N shifts from 0x7FFF.
+		std::array<uint16_t, 0x8000> index15; // Position of each non-zero state in sequence15.
+
+		std::array<uint8_t, PERIOD_7> sequence7; // Low 7 bits after N shifts from 0x7F.
+		std::array<uint8_t, 0x80> index7;
+		std::array<uint16_t, 0x80> settledState7; // Full settled state for each value of the low 7 bits.
+	};
+
+	auto generateTables()
+	{
+		LFSRTables tables{};
+		noiseWave wave{};
+
+		wave.s.LFSR = 0x7FFF;
+
+		for (uint32_t i = 0; i < PERIOD_15; i++)
+		{
+			tables.sequence15[i] = wave.s.LFSR;
+			tables.index15[wave.s.LFSR] = static_cast<uint16_t>(i);
+			wave.shiftLFSR(false);
+		}
+
+		wave.s.LFSR = 0x7FFF;
+
+		for (uint32_t i = 0; i < SETTLE_SHIFTS_7; i++)
+			wave.shiftLFSR(true);
+
+		// 0 is the only state outside the cycle, and it stays 0.
+		for (uint32_t i = 0; i < PERIOD_7; i++)
+		{
+			const uint8_t low { static_cast<uint8_t>(wave.s.LFSR & 0x7F) };
+
+			tables.sequence7[i] = low;
+			tables.index7[low] = static_cast<uint8_t>(i);
+			tables.settledState7[low] = wave.s.LFSR;
+			wave.shiftLFSR(true);
+		}
+
+		return tables;
+	}
+
+	const LFSRTables TABLES { generateTables() };
+}
+
+uint16_t noiseWave::skipLFSR15(uint16_t lfsr, uint32_t shifts)
+{
+	if (lfsr == 0)
+		return 0;
+
+	return TABLES.sequence15[(TABLES.index15[lfsr & 0x7FFF] + shifts) % PERIOD_15];
+}
+
+uint16_t noiseWave::skipLFSR7(uint16_t lfsr, uint32_t shifts)
+{
+	noiseWave wave{};
+	wave.s.LFSR = lfsr;
+
+	for (uint32_t i = 0; i < SETTLE_SHIFTS_7; i++)
+		wave.shiftLFSR(true);
+
+	const uint8_t low { static_cast<uint8_t>(wave.s.LFSR & 0x7F) };
+
+	if (low == 0)
+		return 0;
+
+	return TABLES.settledState7[TABLES.sequence7[(TABLES.index7[low] + shifts - SETTLE_SHIFTS_7) % PERIOD_7]];
+}
\ No newline at end of file
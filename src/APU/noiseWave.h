@@ -1,11 +1,14 @@
 #pragma once
 
 #include <cstdint>
-#include <atomic>
+#include <array>
+#include <bit>
+
+#include "../Utils/bitOps.h"
 
 struct noiseWaveRegs
 {
-	std::atomic<uint8_t> NR41, NR42, NR43, NR44;
+	uint8_t NR41, NR42, NR43, NR44;
 };
 
 struct noiseWaveState
@@ -84,7 +87,7 @@ struct noiseWave
 
 	inline void executeLength()
 	{
-		if (!getBit(regs.NR44.load(), 6) || s.lengthTimer == 0)
+		if (!getBit(regs.NR44, 6) || s.lengthTimer == 0)
 			return;
 
 		s.lengthTimer--;
@@ -93,23 +96,68 @@ struct noiseWave
 			s.enabled = false;
 	}
 
-	inline void execute()
+	// Number of cycles until (and including) the one in which the output bit can next change.
+	inline uint32_t cyclesUntilStep() const
+	{
+		const uint16_t reload = getPeriodTimer();
+		const uint32_t period { reload == 0 ? 0x10000u : reload };
+
+		return s.freqPeriodTimer + 1u + (shiftsUntilOutputChange() - 1) * period;
+	}
+
+	inline void advance(uint32_t cycles)
 	{
-		if (s.freqPeriodTimer == 0)
+		if (cycles <= s.freqPeriodTimer)
 		{
-			s.freqPeriodTimer = getPeriodTimer();
-			const uint8_t xorResult = (s.LFSR & 0x1) ^ ((s.LFSR & 0x2) >> 1);
-			s.LFSR = (s.LFSR >> 1) | (xorResult << 14);
+			s.freqPeriodTimer -= cycles;
+			return;
+		}
+
+		cycles -= s.freqPeriodTimer + 1u;
 
-			const bool smallWidthMode = getBit(regs.NR43.load(), 3);
+		// Period is truncated to the 16 bit timer, 0 wraps around.
+		const uint16_t reload = getPeriodTimer();
+		const uint32_t period { reload == 0 ? 0x10000u : reload };
 
-			if (smallWidthMode)
-				s.LFSR = setBit(s.LFSR, 6, static_cast<bool>(xorResult));
+		advanceLFSR(1 + cycles / period, getBit(regs.NR43, 3));
+		s.freqPeriodTimer = static_cast<uint16_t>(period - 1 - cycles % period);
+	}
+
+	// Short runs are stepped, longer ones jump through the precomputed sequences.
+	inline void advanceLFSR(uint32_t shifts, bool smallWidthMode)
+	{
+		if (shifts <= MAX_STEPPED_SHIFTS) [[likely]]
+		{
+			for (; shifts > 0; shifts--)
+				shiftLFSR(smallWidthMode);
 		}
+		else
+			s.LFSR = smallWidthMode ? skipLFSR7(s.LFSR, shifts) : skipLFSR15(s.LFSR, shifts);
+	}
+
+	inline void shiftLFSR(bool smallWidthMode)
+	{
+		const uint8_t xorResult = (s.LFSR & 0x1) ^ ((s.LFSR & 0x2) >> 1);
+		s.LFSR = (s.LFSR >> 1) | (xorResult << 14);
+
+		if (smallWidthMode)
+			s.LFSR = setBit(s.LFSR, 6, static_cast<bool>(xorResult));
+	}
+
+	// Bit N reaches the output after N shifts, until the first bit shifted in at the top (bit 14, or bit 6 in 7 bit mode).
+	inline uint32_t shiftsUntilOutputChange() const
+	{
+		const uint16_t width { getBit(regs.NR43, 3) ? uint16_t { 0x7F } : uint16_t { 0x7FFF } };
+		const uint16_t diff = (s.LFSR ^ ((s.LFSR & 1) ? width : 0)) & width;
 
-		s.freqPeriodTimer--;
+		return diff == 0 ? std::popcount(width) : std::countr_zero(diff);
 	}
 
+	static uint16_t skipLFSR15(uint16_t lfsr, uint32_t shifts);
+	static uint16_t skipLFSR7(uint16_t lfsr, uint32_t shifts);
+
+	static constexpr uint32_t MAX_STEPPED_SHIFTS = 32;
+
 	inline uint8_t getSample() const
 	{
 		const uint8_t baseAmplitude = ~s.LFSR & 0x01;
@@ -0,0 +1,148 @@
+#include <cmath>
+#include <algorithm>
+#include "resampler.h"
+
+void Resampler::setRates(uint32_t newInputRate, uint32_t newOutputRate)
+{
+	if (newInputRate == inputRate && newOutputRate == outputRate && !kernel.empty())
+		return;
+
+	inputRate = newInputRate;
+	outputRate = newOutputRate;
+	buildKernel();
+	updateStep();
+}
+
+void Resampler::setQuality(ResamplerQuality newQuality)
+{
+	if (newQuality == quality && !kernel.empty())
+		return;
+
+	quality = newQuality;
+	buildKernel();
+}
+
+void Resampler::setRatioAdjust(double adjust)
+{
+	ratioAdjust = adjust;
+	updateStep();
+}
+
+void Resampler::updateStep()
+{
+	step = static_cast<uint64_t>(std::llround(static_cast<double>(inputRate) / (outputRate * ratioAdjust) * 4294967296.0));
+}
+
+void Resampler::reset()
+{
+	position = 0;
+	historyLeft.clear();
+	historyRight.clear();
+}
+
+void Resampler::buildKernel()
+{
+	constexpr double PI { 3.14159265358979323846 };
+
+	// When downsampling, cutoff has to be lowered to the output nyquist frequency, and the kernel gets proportionally wider.
+	const double ratio { std::min(1.0, static_cast<double>(outputRate) / inputRate) };
+	const auto tapsFor = [ratio](int baseTaps) { return std::min((static_cast<int>(std::ceil(baseTaps / ratio)) + 3) & ~3, 1024); };
+
+	double cutoff { 1.0 };
+
+	switch (quality)
+	{
+	case ResamplerQuality::Fast:
+		taps = 4; // Only the middle two are non-zero.
+		break;
+	case ResamplerQuality::Balanced:
+		taps = tapsFor(16);
+		cutoff = 0.85 * ratio;
+		break;
+	case ResamplerQuality::Best:
+		taps = tapsFor(48);
+		cutoff = 0.95 * ratio;
+		break;
+	}
+
+	const int halfWidth { taps / 2 };
+	kernel.assign(static_cast<size_t>((PHASES + 1) * taps), 0.f);
+
+	for (int phase = 0; phase <= PHASES; phase++)
+	{
+		float* phaseKernel { &kernel[static_cast<size_t>(phase * taps)] };
+		double sum { 0.0 };
+
+		for (int i = 0; i < taps; i++)
+		{
+			// Distance of the tap from the output position, in input samples.
+			const double x { i - (halfWidth - 1) - static_cast<double>(phase) / PHASES };
+			double val;
+
+			if (quality == ResamplerQuality::Fast)
+				val = std::max(0.0, 1.0 - std::abs(x));
+			else
+			{
+				const double sinc { x == 0.0 ? cutoff : std::sin(PI * cutoff * x) / (PI * x) };
+				const double window { 0.42 + 0.5 * std::cos(PI * x / halfWidth) + 0.08 * std::cos(2 * PI * x / halfWidth) }; // Blackman
+				val = sinc * window;
+			}
+
+			phaseKernel[i] = static_cast<float>(val);
+			sum += val;
+		}
+
+		// Unity gain at DC for every phase.
+		for (int i = 0; i < taps; i++)
+			phaseKernel[i] = static_cast<float>(phaseKernel[i] / sum);
+	}
+}
+
+void Resampler::process(const int16_t* input, size_t inputFrames, std::vector<int16_t>& output)
+{
+	for (size_t i = 0; i < inputFrames; i++)
+	{
+		historyLeft.push_back(input[i * 2]);
+		historyRight.push_back(input[i * 2 + 1]);
+	}
+
+	const auto toSample = [](float val) { return static_cast<int16_t>(std::clamp(std::lrint(val), static_cast<long>(INT16_MIN), static_cast<long>(INT16_MAX))); };
+
+	// Output is delayed by half the kernel width, so only the history ahead of the position needs to be available.
+	while ((position >> 32) + taps <= historyLeft.size())
+	{
+		const size_t start { static_cast<size_t>(position >> 32) };
+		const uint32_t frac { static_cast<uint32_t>(position) };
+
+		const int phase { static_cast<int>(frac >> 24) };
+		const float weight { static_cast<float>(frac & 0xFFFFFF) / (1 << 24) };
+
+		const float* k0 { &kernel[static_cast<size_t>(phase * taps)] };
+		const float* k1 { k0 + taps };
+		const float* histL { &historyLeft[start] };
+		const float* histR { &historyRight[start] };
+
+		// Separate partial sums per lane, taps is a multiple of 4 so this maps to SIMD registers without reassociation.
+		float left[4] {}, right[4] {};
+
+		for (int i = 0; i < taps; i += 4)
+		{
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const float k { k0[i + lane] + (k1[i + lane] - k0[i + lane]) * weight };
+				left[lane] += histL[i + lane] * k;
+				right[lane] += histR[i + lane] * k;
+			}
+		}
+
+		output.push_back(toSample((left[0] + left[1]) + (left[2] + left[3])));
+		output.push_back(toSample((right[0] + right[1]) + (right[2] + right[3])));
+
+		position += step;
+	}
+
+	const size_t consumed { std::min(static_cast<size_t>(position >> 32), historyLeft.size()) };
+	historyLeft.erase(historyLeft.begin(), historyLeft.begin() + static_cast<std::ptrdiff_t>(consumed));
+	historyRight.erase(historyRight.begin(), historyRight.begin() + static_cast<std::ptrdiff_t>(consumed));
+	position -= static_cast<uint64_t>(consumed) << 32;
+}
\ No newline at end of file
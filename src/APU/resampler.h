@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+enum class ResamplerQuality : uint8_t
+{
+	Fast, // Linear interpolation.
+	Balanced, // 16 tap windowed sinc.
+	Best // 48 tap windowed sinc.
+};
+
+// Polyphase windowed sinc resampler for interleaved stereo 16 bit samples.
+class Resampler
+{
+public:
+	void setRates(uint32_t inputRate, uint32_t outputRate);
+	void setQuality(ResamplerQuality newQuality);
+	inline ResamplerQuality getQuality() const { return quality; }
+
+	// Scales the output rate, e.g. 1.001 produces 0.1% more samples. Meant for small adjustments, filter cutoff is not updated.
+	void setRatioAdjust(double adjust);
+	inline double getRatioAdjust() const { return ratioAdjust; }
+
+	void reset();
+
+	// Resamples inputFrames stereo frames and appends the result to output.
+	void process(const int16_t* input, size_t inputFrames, std::vector<int16_t>& output);
+private:
+	void updateStep();
+	void buildKernel();
+
+	static constexpr int PHASES = 256;
+
+	uint32_t inputRate { 1 }, outputRate { 1 };
+	ResamplerQuality quality { ResamplerQuality::Balanced };
+	double ratioAdjust { 1.0 };
+
+	uint64_t step{}; // Input frames per output frame, 32.32 fixed point.
+	uint64_t position{}; // Position of the next output frame relative to the start of history.
+
+	int taps{};
+	std::vector<float> kernel; // (PHASES + 1) * taps, an extra phase so interpolation doesn't need to wrap.
+
+	std::vector<float> historyLeft, historyRight;
+};
\ No newline at end of file
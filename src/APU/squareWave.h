@@ -1,13 +1,12 @@
 #pragma once
 #include <cstdint>
 #include <array>
-#include <atomic>
 
 #include "../Utils/bitOps.h"
 
 struct squareWaveRegs
 {
-	std::atomic<uint8_t> NRx1, NRx2, NRx3, NRx4;
+	uint8_t NRx1, NRx2, NRx3, NRx4;
 };
 
 struct squareWaveState
@@ -80,7 +79,7 @@ struct squareWave
 
 	inline void executeLength()
 	{
-		if (!getBit(regs.NRx4.load(), 6) || s.lengthTimer == 0) 
+		if (!getBit(regs.NRx4, 6) || s.lengthTimer == 0) 
 			return;
 
 		s.lengthTimer--;
@@ -89,15 +88,23 @@ struct squareWave
 			s.enabled = false;
 	}
 
-	inline void execute()
+	// Number of cycles until (and including) the one in which the next duty step happens.
+	inline uint32_t cyclesUntilStep() const { return s.freqPeriodTimer + 1u; }
+
+	// Equivalent to executing the frequency timer once per cycle.
+	inline void advance(uint32_t cycles)
 	{
-		if (s.freqPeriodTimer == 0)
+		if (cycles <= s.freqPeriodTimer)
 		{
-			s.freqPeriodTimer = 2048 - getFrequency();
-			s.dutyStep = (s.dutyStep + 1) & 7;
+			s.freqPeriodTimer -= cycles;
+			return;
 		}
 
-		s.freqPeriodTimer--;
+		cycles -= s.freqPeriodTimer + 1u;
+		const uint32_t period { 2048u - getFrequency() };
+
+		s.dutyStep = (s.dutyStep + 1 + cycles / period) & 7;
+		s.freqPeriodTimer = period - 1 - cycles % period;
 	}
 
 	inline uint8_t getSample() const
@@ -4,7 +4,7 @@
 
 struct sweepWaveRegs : squareWaveRegs
 {
-	std::atomic<uint8_t> NR10;
+	uint8_t NR10;
 };
 
 struct sweepWaveState : squareWaveState
@@ -73,7 +73,7 @@ struct sweepWave : public squareWave<sweepWaveState, sweepWaveRegs>
 	uint16_t calculateFrequency()
 	{
 		const uint8_t sweepShift = (regs.NR10 & 0b111);
-		const bool isDecrementing = getBit(regs.NR10.load(), 3);
+		const bool isDecrementing = getBit(regs.NR10, 3);
 		uint16_t newFrequency = s.shadowFrequency >> sweepShift;
 
 		if (isDecrementing)
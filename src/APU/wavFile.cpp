@@ -0,0 +1,51 @@
+#include <climits>
+#include "wavFile.h"
+
+#define WRITE(val) st.write(reinterpret_cast<const char*>(&val), sizeof(val));
+
+namespace WAVFile
+{
+	void writeHeader(std::ostream& st, uint32_t sampleRate, uint16_t channels)
+	{
+		constexpr uint16_t BITS_PER_SAMPLE = sizeof(int16_t) * CHAR_BIT;
+		const uint32_t BYTE_RATE = sampleRate * sizeof(int16_t) * channels;
+		constexpr uint32_t SECTION_CHUNK_SIZE = 16;
+		const uint16_t BLOCK_ALIGN = static_cast<uint16_t>((BITS_PER_SAMPLE * channels) / CHAR_BIT);
+		constexpr uint16_t PCM_FORMAT = 1;
+
+		st.write("RIFF", 4);
+
+		uint32_t lengthReserve{};
+		WRITE(lengthReserve);
+		st.write("WAVE", 4);
+		st.write("fmt ", 4);
+
+		WRITE(SECTION_CHUNK_SIZE);
+		WRITE(PCM_FORMAT);
+		WRITE(channels);
+		WRITE(sampleRate);
+		WRITE(BYTE_RATE);
+		WRITE(BLOCK_ALIGN);
+		WRITE(BITS_PER_SAMPLE);
+
+		st.write("data", 4);
+
+		uint32_t dataLengthReserve{};
+		WRITE(dataLengthReserve);
+	}
+
+	void finalize(std::ostream& st)
+	{
+		st.seekp(0, std::ios::end);
+		const uint32_t fileSize = static_cast<uint32_t>(st.tellp()) - 8;
+
+		st.seekp(4, std::ios::beg);
+		WRITE(fileSize);
+
+		const uint32_t dataSize = fileSize - 36; // Header is 44 bytes, 44 - 8 = 36.
+		st.seekp(40, std::ios::beg);
+		WRITE(dataSize);
+	}
+}
+
+#undef WRITE
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+
+// 16 bit PCM WAV file helpers.
+namespace WAVFile
+{
+	// Chunk sizes are left as zero until finalize().
+	void writeHeader(std::ostream& st, uint32_t sampleRate, uint16_t channels);
+
+	// Fills in the RIFF and data chunk sizes, which are only known once all samples are written.
+	void finalize(std::ostream& st);
+}
\ No newline at end of file
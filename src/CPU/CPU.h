@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <iostream>
 #include <memory>
+#include <functional>
 #include "registers.h"
 #include "../Utils/bitOps.h"
 
@@ -23,13 +24,14 @@ class CPU
 	friend CPUInstructions;
 	friend class MMU;
 	friend class debugUI;
+	friend class GBCore;
 
 public:
 	uint8_t execute();
 	void requestInterrupt(Interrupt interrupt);
 	void executeTimer();
 
-	std::string disassemble(uint16_t addr, uint8_t(*readFunc)(uint16_t), uint8_t* instrLen);
+	std::string disassemble(uint16_t addr, const std::function<uint8_t(uint16_t)>& readFunc, uint8_t* instrLen);
 
 	explicit CPU(GBCore& gbCore);
 	~CPU();
@@ -6,7 +6,7 @@
 #include "../GBCore.h"
 #include "../defines.h"
 
-std::string CPU::disassemble(uint16_t addr, uint8_t(*readFunc)(uint16_t), uint8_t* instrLen)
+std::string CPU::disassemble(uint16_t addr, const std::function<uint8_t(uint16_t)>& readFunc, uint8_t* instrLen)
 {
     *instrLen = 0;
     const auto read8 = [this, &instrLen, &readFunc](uint16_t addr) { (*instrLen)++; return readFunc(addr); };
@@ -0,0 +1,276 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <bit>
+#include "cpuTracer.h"
+
+namespace
+{
+	constexpr size_t OUT_BUFFER_SIZE = 1 << 16;
+	constexpr size_t MAX_PACKED_SIZE = sizeof(uint32_t) + sizeof(cpuTraceRecord);
+
+	// Cycles are stored as the difference from the previous record, other fields XORed with it, so unchanged bytes become zeroes.
+	// Only the nonzero bytes are kept, after a mask of their positions. That shrinks records to about a third before deflate sees them.
+	inline size_t deltaEncode(const cpuTraceRecord& rec, const cpuTraceRecord& prev, uint8_t* out)
+	{
+		constexpr size_t WORDS = sizeof(cpuTraceRecord) / sizeof(uint64_t);
+
+		std::array<uint64_t, WORDS> recWords, prevWords, delta;
+		std::memcpy(recWords.data(), &rec, sizeof(rec));
+		std::memcpy(prevWords.data(), &prev, sizeof(prev));
+
+		uint32_t mask { 0 };
+
+		for (size_t i = 0; i < WORDS; i++)
+		{
+			// The first word is the cycle count.
+			delta[i] = i == 0 ? recWords[i] - prevWords[i] : recWords[i] ^ prevWords[i];
+
+			// Folds each byte into its lowest bit, then gathers those into one bit per byte.
+			uint64_t nonzero { delta[i] | (delta[i] >> 4) };
+			nonzero |= nonzero >> 2;
+			nonzero |= nonzero >> 1;
+			nonzero &= 0x0101010101010101;
+			mask |= static_cast<uint32_t>((nonzero * 0x0102040810204080) >> 56) << (i * 8);
+		}
+
+		std::memcpy(out, &mask, sizeof(mask));
+		size_t len { sizeof(mask) };
+
+		const auto* deltaBytes { reinterpret_cast<const uint8_t*>(delta.data()) };
+
+		for (uint32_t remaining = mask; remaining != 0; remaining &= remaining - 1)
+			out[len++] = deltaBytes[std::countr_zero(remaining)];
+
+		return len;
+	}
+
+	// Applies a packed record to the previous one in rec. Returns the number of bytes consumed, or 0 if the record isn't complete yet.
+	inline size_t deltaDecode(const uint8_t* in, size_t available, cpuTraceRecord& rec)
+	{
+		uint32_t mask;
+
+		if (available < sizeof(mask))
+			return 0;
+
+		std::memcpy(&mask, in, sizeof(mask));
+		const size_t len { sizeof(mask) + std::popcount(mask) };
+
+		if (available < len)
+			return 0;
+
+		std::array<uint8_t, sizeof(cpuTraceRecord)> delta{};
+		size_t pos { sizeof(mask) };
+
+		for (uint32_t remaining = mask; remaining != 0; remaining &= remaining - 1)
+			delta[std::countr_zero(remaining)] = in[pos++];
+
+		auto* recBytes { reinterpret_cast<uint8_t*>(&rec) };
+
+		for (size_t i = sizeof(uint64_t); i < delta.size(); i++)
+			recBytes[i] ^= delta[i];
+
+		uint64_t cycleDelta;
+		std::memcpy(&cycleDelta, delta.data(), sizeof(cycleDelta));
+		rec.cycles += cycleDelta;
+		return len;
+	}
+}
+
+bool CPUTracer::start(const std::filesystem::path& filePath)
+{
+	stop();
+
+	stream = std::ofstream { filePath, std::ios::binary };
+
+	if (!stream)
+		return false;
+
+	deflateStream = {};
+
+	if (mz_deflateInit(&deflateStream, COMPRESSION_LEVEL) != MZ_OK)
+	{
+		stream.close();
+		return false;
+	}
+
+	const uint32_t recordSize { sizeof(cpuTraceRecord) };
+	stream.write(SIGNATURE.data(), SIGNATURE.size());
+	stream.write(reinterpret_cast<const char*>(&FORMAT_VERSION), sizeof(FORMAT_VERSION));
+	stream.write(reinterpret_cast<const char*>(&recordSize), sizeof(recordSize));
+
+	// Nothing is pushed while not recording, so this thread is the only consumer for now.
+	ring.clear();
+	chunk.resize(CHUNK_RECORDS);
+	deltaBuffer.clear();
+	outBuffer.resize(OUT_BUFFER_SIZE);
+	previous = {};
+	recorded = 0;
+
+	stopRequested = false;
+	recording = true;
+
+#ifndef EMSCRIPTEN
+	writerThread = std::thread { &CPUTracer::writerLoop, this };
+#endif
+	return true;
+}
+
+void CPUTracer::stop()
+{
+	if (!recording)
+		return;
+
+	recording = false;
+
+#ifdef EMSCRIPTEN
+	while (drain()) {}
+#else
+	stopRequested = true;
+	writerThread.join();
+#endif
+
+	compress(MZ_FINISH);
+	mz_deflateEnd(&deflateStream);
+	stream.close();
+}
+
+void CPUTracer::waitForWriter()
+{
+#ifdef EMSCRIPTEN
+	drain();
+#else
+	std::this_thread::yield();
+#endif
+}
+
+void CPUTracer::writerLoop()
+{
+	while (true)
+	{
+		// Checked before draining, so records pushed before the stop request are always written.
+		const bool stopping { stopRequested };
+
+		if (!drain())
+		{
+			if (stopping)
+				break;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+	}
+}
+
+bool CPUTracer::drain()
+{
+	const size_t count { ring.pop(chunk.data(), CHUNK_RECORDS) };
+
+	if (count == 0)
+		return false;
+
+	deltaBuffer.resize(count * MAX_PACKED_SIZE);
+	size_t packedSize { 0 };
+
+	for (size_t i = 0; i < count; i++)
+	{
+		packedSize += deltaEncode(chunk[i], previous, deltaBuffer.data() + packedSize);
+		previous = chunk[i];
+	}
+
+	deltaBuffer.resize(packedSize);
+	compress(MZ_NO_FLUSH);
+	return true;
+}
+
+void CPUTracer::compress(int flush)
+{
+	deflateStream.next_in = deltaBuffer.data();
+	deflateStream.avail_in = static_cast<unsigned int>(deltaBuffer.size());
+
+	while (true)
+	{
+		deflateStream.next_out = outBuffer.data();
+		deflateStream.avail_out = static_cast<unsigned int>(outBuffer.size());
+
+		const int status { mz_deflate(&deflateStream, flush) };
+		stream.write(reinterpret_cast<const char*>(outBuffer.data()), static_cast<std::streamsize>(outBuffer.size() - deflateStream.avail_out));
+
+		if (status == MZ_STREAM_END || status < 0)
+			break;
+
+		// Without finishing, deflate keeps input it can't emit yet, so it's done once all input is taken and output has space left.
+		if (flush != MZ_FINISH && deflateStream.avail_in == 0 && deflateStream.avail_out != 0)
+			break;
+	}
+
+	deltaBuffer.clear();
+}
+
+bool CPUTracer::expandToText(std::istream& in, std::ostream& out, bool extended)
+{
+	std::array<char, 8> signature{};
+	uint32_t version { 0 }, recordSize { 0 };
+
+	in.read(signature.data(), signature.size());
+	in.read(reinterpret_cast<char*>(&version), sizeof(version));
+	in.read(reinterpret_cast<char*>(&recordSize), sizeof(recordSize));
+
+	if (!in || signature != SIGNATURE || version != FORMAT_VERSION || recordSize != sizeof(cpuTraceRecord))
+		return false;
+
+	mz_stream inflateStream{};
+
+	if (mz_inflateInit(&inflateStream) != MZ_OK)
+		return false;
+
+	std::vector<uint8_t> inBuffer(OUT_BUFFER_SIZE);
+	std::vector<uint8_t> packed(OUT_BUFFER_SIZE);
+	size_t filled { 0 };
+
+	cpuTraceRecord rec{};
+	std::array<char, 160> line;
+	int status { MZ_OK };
+
+	while (status != MZ_STREAM_END)
+	{
+		if (inflateStream.avail_in == 0 && in)
+		{
+			in.read(reinterpret_cast<char*>(inBuffer.data()), static_cast<std::streamsize>(inBuffer.size()));
+			inflateStream.next_in = inBuffer.data();
+			inflateStream.avail_in = static_cast<unsigned int>(in.gcount());
+		}
+
+		inflateStream.next_out = packed.data() + filled;
+		inflateStream.avail_out = static_cast<unsigned int>(packed.size() - filled);
+
+		status = mz_inflate(&inflateStream, MZ_NO_FLUSH);
+
+		// A truncated trace ends with MZ_BUF_ERROR once the input runs out.
+		if (status != MZ_OK && status != MZ_STREAM_END)
+			break;
+
+		filled = packed.size() - inflateStream.avail_out;
+		size_t used { 0 };
+
+		while (const size_t len { deltaDecode(packed.data() + used, filled - used, rec) })
+		{
+			used += len;
+
+			int lineLen { std::snprintf(line.data(), line.size(), "A:%02X F:%02X B:%02X C:%02X D:%02X E:%02X H:%02X L:%02X SP:%04X PC:%04X PCMEM:%02X,%02X,%02X,%02X",
+				rec.A, rec.F, rec.B, rec.C, rec.D, rec.E, rec.H, rec.L, rec.SP, rec.PC, rec.pcMem[0], rec.pcMem[1], rec.pcMem[2], rec.pcMem[3]) };
+
+			if (extended)
+				lineLen += std::snprintf(line.data() + lineLen, line.size() - lineLen, " IF:%02X IE:%02X LY:%02X CYC:%llu", rec.IF, rec.IE, rec.LY, static_cast<unsigned long long>(rec.cycles));
+
+			line[lineLen++] = '\n';
+			out.write(line.data(), lineLen);
+		}
+
+		// Keeps a partially inflated record for the next round.
+		std::memmove(packed.data(), packed.data() + used, filled - used);
+		filled -= used;
+	}
+
+	mz_inflateEnd(&inflateStream);
+	return status == MZ_STREAM_END && filled == 0;
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <thread>
+#include <miniz/miniz.h>
+
+#include "../Utils/spscRing.h"
+
+// CPU state right before an instruction executes.
+struct cpuTraceRecord
+{
+	uint64_t cycles; // T-cycles since power on.
+	uint16_t PC, SP;
+	uint8_t A, F, B, C, D, E, H, L;
+	std::array<uint8_t, 4> pcMem; // Opcode and the next 3 bytes.
+	uint8_t IF, IE, LY;
+	uint8_t padding;
+};
+
+static_assert(sizeof(cpuTraceRecord) == 32);
+
+// Records one fixed size binary record per instruction. record() only copies into a preallocated ring, a writer thread
+// delta codes each record against the previous one, keeps only the changed bytes and deflates them into the file.
+// Nothing is dropped: if the writer falls behind, record() waits for it.
+class CPUTracer
+{
+public:
+	~CPUTracer() { stop(); }
+
+	bool start(const std::filesystem::path& filePath);
+	void stop();
+
+	inline bool active() const { return recording; }
+	inline uint64_t recordedInstructions() const { return recorded; }
+
+	inline void record(const cpuTraceRecord& rec)
+	{
+		while (ring.push(&rec, 1) == 0) [[unlikely]]
+			waitForWriter();
+
+		recorded.store(recorded.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Text log in the Gameboy Doctor format ("A:01 F:B0 B:00 ... PC:0100 PCMEM:00,C3,13,02"),
+	// extended adds IF, IE, LY and the cycle count. Returns false if the trace is invalid or truncated.
+	static bool expandToText(std::istream& in, std::ostream& out, bool extended);
+private:
+	static constexpr std::array<char, 8> SIGNATURE { 'M', 'B', 'T', 'R', 'A', 'C', 'E', '\0' };
+	static constexpr uint32_t FORMAT_VERSION = 1;
+	static constexpr size_t CHUNK_RECORDS = 4096;
+	static constexpr int COMPRESSION_LEVEL = 1; // Delta coded records are mostly zeroes, faster levels barely compress worse.
+
+	void writerLoop();
+	void waitForWriter();
+	bool drain();
+	void compress(int flush);
+
+	SPSCRing<cpuTraceRecord, 1 << 16> ring; // 2 MiB.
+
+	std::vector<cpuTraceRecord> chunk;
+	std::vector<uint8_t> deltaBuffer, outBuffer;
+	cpuTraceRecord previous{};
+
+	mz_stream deflateStream{};
+	std::ofstream stream;
+
+	std::thread writerThread;
+	std::atomic<bool> stopRequested { false };
+	std::atomic<bool> recording { false };
+	std::atomic<uint64_t> recorded { 0 };
+};
\ No newline at end of file
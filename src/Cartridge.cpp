@@ -2,6 +2,7 @@
 
 #include "Cartridge.h"
 #include "GBCore.h"
+#include "Utils/memstream.h"
 
 #include "Mappers/NoMBC.h"
 #include "Mappers/MBC1.h"
@@ -12,8 +13,10 @@
 #include "Mappers/HuC1.h"
 #include "Mappers/HuC3.h"
 
-Cartridge::Cartridge(GBCore& gbCore) : gb(gbCore), rom(std::vector<uint8_t>(MIN_ROM_SIZE * 2, 0xFF)), mapper(std::make_unique<RomOnlyMBC>(*this))
-{}
+Cartridge::Cartridge(GBCore& gbCore) : gb(gbCore), mapper(std::make_unique<RomOnlyMBC>(*this))
+{
+	setROM(std::make_shared<const std::vector<uint8_t>>(MIN_ROM_SIZE * 2, 0xFF));
+}
 
 uint64_t Cartridge::getGBCycles() const { return gb.cycleCount(); }
 
@@ -25,9 +28,7 @@ void Cartridge::unload()
 	romBanks = 2;
 	ramBanks = 0;
 
-	rom.resize(MIN_ROM_SIZE * 2);
-	std::memset(rom.data(), 0xFF, MIN_ROM_SIZE * 2);
-	rom.shrink_to_fit();
+	setROM(std::make_shared<const std::vector<uint8_t>>(MIN_ROM_SIZE * 2, 0xFF));
 
 	ram.clear();
 	ram.shrink_to_fit();
@@ -48,35 +49,49 @@ bool Cartridge::loadROM(std::istream& st)
 	if (!processCartridgeHeader(st))
 		return false;
 
+	uint32_t paddedSize { size };
+
 	// 16 KB
 	if (size == MIN_ROM_SIZE)
 	{
 		// Pad to 32 KB
-		rom.resize(MIN_ROM_SIZE * 2);
-		std::memset(rom.data() + MIN_ROM_SIZE, 0xFF, MIN_ROM_SIZE);
+		paddedSize = MIN_ROM_SIZE * 2;
 	}
 	else
 	{
 		// If rom size is not power of 2, pad to the next one.
 		if ((size & (size - 1)) != 0)
 		{
-			uint32_t newSize { 1 };
+			paddedSize = 1;
 
-			while (newSize < size)
-				newSize <<= 1;
-
-			rom.resize(newSize);
-			std::memset(rom.data() + size, 0xFF, (newSize - size));
+			while (paddedSize < size)
+				paddedSize <<= 1;
 		}
-		else
-			rom.resize(size);
 	}
 
+	std::vector<uint8_t> data(paddedSize, 0xFF);
+	st.seekg(0, std::ios::beg);
+	st.read(reinterpret_cast<char*>(data.data()), size);
+
+	setROM(std::make_shared<const std::vector<uint8_t>>(std::move(data)));
 	this->romBanks = rom.size() / romBankSize();
 
-	rom.shrink_to_fit();
-	st.seekg(0, std::ios::beg);
-	st.read(reinterpret_cast<char*>(rom.data()), size);
+	romLoaded = true;
+	return true;
+}
+
+bool Cartridge::shareROM(const Cartridge& other)
+{
+	if (!other.romLoaded)
+		return false;
+
+	memstream st { other.rom };
+
+	if (!processCartridgeHeader(st))
+		return false;
+
+	setROM(other.romData);
+	this->romBanks = rom.size() / romBankSize();
 
 	romLoaded = true;
 	return true;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <span>
 #include <vector>
 
 #include "Mappers/MBCBase.h"
@@ -45,10 +46,13 @@ public:
 
 	RTC* rtc { nullptr };
 
-	std::vector<uint8_t> rom{};
+	std::span<const uint8_t> rom{};
 	std::vector<uint8_t> ram{};
 
 	bool loadROM(std::istream& st);
+
+	// Uses the ROM data of another loaded cartridge without copying it.
+	bool shareROM(const Cartridge& other);
 	void unload();
 
 	static uint8_t calculateHeaderChecksum(std::istream& st);
@@ -70,7 +74,14 @@ private:
 	bool processCartridgeHeader(std::istream& st);
 	static void updateSystem(uint8_t cgbFlag);
 
+	inline void setROM(std::shared_ptr<const std::vector<uint8_t>> data)
+	{
+		romData = std::move(data);
+		rom = *romData;
+	}
+
 	GBCore& gb;
+	std::shared_ptr<const std::vector<uint8_t>> romData; // Never modified once loaded, so cartridges running the same ROM can share it.
 	std::unique_ptr<MBCBase> mapper;
 	uint8_t mapperID { 0x00 };
 
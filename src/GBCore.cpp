@@ -1,12 +1,21 @@
 ﻿#include <fstream>
+#include <cmath>
 #include <string>
+#include <chrono>
+#include <random>
+#include <iomanip>
 #include <miniz/miniz.h>
 
 #include "GBCore.h"
 #include "appConfig.h"
 #include "Utils/fileUtils.h"
 #include "Utils/memstream.h"
+#include "Utils/rngOps.h"
+#include "Utils/profiler.h"
+
+#ifndef MEGABOY_HEADLESS
 #include "debugUI.h"
+#endif
 
 GBCore::GBCore()
 {
@@ -40,7 +49,7 @@ void GBCore::updatePPUSystem()
 
 	ppu->setDebugEnable(ppuDebugEnable);
 
-	ppu->drawCallback = [&](const uint8_t* framebuf, bool firstFrame) 
+	ppu->drawCallback = [&](const uint8_t* framebuf, bool firstFrame, bool frameChanged) 
 	{
 		for (const auto& cheat : gameSharks)
 		{
@@ -48,12 +57,21 @@ void GBCore::updatePPUSystem()
 				mmu.write8(cheat.addr, cheat.newData);
 		}
 
-		if (this->drawCallback != nullptr)
-			this->drawCallback(framebuf, firstFrame);
+		const bool frameRendered { ppu->renderingEnabled() };
+
+		// Callback is invoked on VBlank, so the next frame is either rendered or skipped as a whole.
+		frameSkipCounter = (frameSkipCounter + 1) % frameSkipRatio;
+		ppu->setRenderEnable(frameSkipCounter == 0);
+
+		if (frameRendered && (frameChanged || firstFrame))
+			frameChangeCount++;
+
+		if (frameRendered && this->drawCallback != nullptr)
+			this->drawCallback(framebuf, firstFrame, frameChanged);
 	};
 }
 
-void GBCore::reset(bool resetBattery, bool clearBuf, bool fullReset)
+void GBCore::reset(bool resetBattery, bool clearBuf, bool fullReset, bool initMemory)
 {
 	if (fullReset)
 	{
@@ -72,9 +90,9 @@ void GBCore::reset(bool resetBattery, bool clearBuf, bool fullReset)
 			updateSystem();
 	}
 
-	ppu->reset(clearBuf);
+	ppu->reset(clearBuf, initMemory);
 	cpu.reset();
-	mmu.reset();
+	mmu.reset(initMemory);
 	serial.reset();
 	joypad.reset();
 	apu.reset();
@@ -179,48 +197,408 @@ bool GBCore::runNoCartridgeBootROM(GBSystem bootSys)
 template void GBCore::emulateFrameBase<true>();
 template void GBCore::emulateFrameBase<false>();
 
-template <bool checkBreakpoints>
+template <bool instrumented>
 void GBCore::emulateFrameBase()
 {
 	if (!executingProgram() || emulationPaused) [[unlikely]]
 		return;
 
+	PROFILE_SCOPE(Frame);
+
 	const uint32_t frameCycles { CYCLES_PER_FRAME * speedFactor };
-	const uint64_t targetCycles { cycleCounter + frameCycles };
+	executeUntil<instrumented>(cycleCounter + frameCycles);
+
+	apu.endFrame();
+
+	if (avRecorder.active()) [[unlikely]]
+	{
+		avRecorder.addVideoFrame(ppu->framebufferPtr(), frameChangeCount != recordedFrameChangeCount);
+		recordedFrameChangeCount = frameChangeCount;
+	}
+
+	if (movie.recording()) [[unlikely]]
+		addMovieKeyframe();
+
+	cpuUsageCycles += frameCycles;
+
+	if (++frameCounter % 60 == 0)
+	{
+		cpuUsage = 100.f - ((static_cast<double>(cpu.haltCycleCount()) / cpuUsageCycles) * 100);
+		cpu.resetHaltCycleCount();
+		cpuUsageCycles = 0;
+	}
+}
+
+cpuTraceRecord GBCore::makeTraceRecord()
+{
+	const uint16_t pc { cpu.s.PC };
+	const auto& regs { cpu.registers };
+
+	return cpuTraceRecord
+	{
+		.cycles = cycleCounter,
+		.PC = pc,
+		.SP = cpu.s.SP.val,
+		.A = regs.AF.high.val, .F = regs.AF.low.val,
+		.B = regs.BC.high.val, .C = regs.BC.low.val,
+		.D = regs.DE.high.val, .E = regs.DE.low.val,
+		.H = regs.HL.high.val, .L = regs.HL.low.val,
+		.pcMem = { mmu.read8(pc), mmu.read8(pc + 1), mmu.read8(pc + 2), mmu.read8(pc + 3) },
+		.IF = cpu.s.IF, .IE = cpu.s.IE, .LY = ppu->s.LY,
+		.padding = 0
+	};
+}
+
+template <bool instrumented>
+void GBCore::executeUntil(uint64_t targetCycles)
+{
+	PROFILE_SCOPE(CPU);
 
 	while (cycleCounter < targetCycles)
 	{
-		if constexpr (checkBreakpoints)
+		// Movie inputs are applied on their exact cycle, so execution is split there.
+		const uint64_t stopCycles { movie.playing() ? std::min(targetCycles, applyMovieInputs()) : targetCycles };
+
+		while (cycleCounter < stopCycles)
 		{
-			if (breakpoints[cpu.getPC()] || opcodeBreakpoints[mmu.read8(cpu.getPC())]) [[unlikely]]
+			if constexpr (instrumented)
 			{
-				breakpointHit = true;
-				debugUI::signalBreakpoint();
+				const uint16_t pc { cpu.getPC() };
+
+				if (enableBreakpointChecks)
+				{
+					if (breakpoints[pc] || opcodeBreakpoints[mmu.read8(pc)]) [[unlikely]]
+					{
+						breakpointHit = true;
+#ifndef MEGABOY_HEADLESS
+						debugUI::signalBreakpoint();
+#endif
+					}
+
+					if (breakpointHit) [[unlikely]]
+						return;
+				}
+
+				if (cpuTracer.active())
+					cpuTracer.record(makeTraceRecord());
+
+				// Taken before executing, since the instruction itself can switch banks.
+				const uint16_t romBank { pcProfiler.active() ? currentRomBank(pc) : uint16_t { 0 } };
+
+				const uint8_t cycles { cpu.execute() };
+				cycleCounter += cycles;
+
+				if (pcProfiler.active())
+					pcProfiler.add(pc, romBank, cycles);
 			}
+			else
+				cycleCounter += cpu.execute();
+		}
+	}
+}
+
+std::string GBCore::describeHotSpot(const PCProfiler::hotSpot& spot)
+{
+	// ROM is read from the profiled bank, not the one mapped now.
+	const auto readFunc = [this, bankOffset = spot.bank * PCProfiler::ROM_BANK_SIZE](uint16_t addr) -> uint8_t
+	{
+		if (addr >= PCProfiler::NON_ROM_START)
+			return mmu.read8(addr);
+
+		const uint32_t romAddr { bankOffset + (addr & (PCProfiler::ROM_BANK_SIZE - 1)) };
+		return romAddr < cartridge.rom.size() ? cartridge.rom[romAddr] : 0xFF;
+	};
+
+	const uint64_t total { pcProfiler.totalCycles() };
+	const double share { total == 0 ? 0.0 : spot.cycles * 100.0 / total };
+
+	uint8_t instrLen;
+	std::ostringstream st;
+
+	st << std::uppercase << std::hex << std::setfill('0');
+
+	if (spot.inROM)
+		st << std::setw(2) << spot.bank << ':';
+	else
+		st << "RAM:";
+
+	st << std::setw(4) << spot.addr << "  " << std::dec << std::fixed << std::setprecision(2) << std::setw(6) << std::setfill(' ') << share << "%  "
+	   << cpu.disassemble(spot.addr, readFunc, &instrLen);
+
+	return st.str();
+}
+
+bool GBCore::startAVRecording(const std::filesystem::path& filePath)
+{
+	if (!executingProgram())
+		return false;
+
+	return avRecorder.start(filePath, PPU::SCR_WIDTH, PPU::SCR_HEIGHT, CYCLES_PER_SECOND, CYCLES_PER_FRAME, APU::NATIVE_SAMPLE_RATE);
+}
+
+bool GBCore::startMovieRecording(const std::filesystem::path& filePath, MovieStart start)
+{
+	if (!cartridge.loaded() || (start == MovieStart::SaveState && !canSaveStateNow()))
+		return false;
+
+	stopMovie();
+
+	movie.start = start;
+	movie.romChecksum = cartridge.getChecksum();
+	movie.romPath = FileUtils::pathToUTF8(romFilePath);
+	movie.rtcTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+	std::ostringstream st{};
+
+	if (start == MovieStart::PowerOn)
+	{
+		movie.rngSeed = std::random_device{}();
+		movie.bootROM = appConfig::runBootROM;
 
-			if (breakpointHit) [[unlikely]]
-				break;
+		if (cartridge.hasBattery)
+			saveBattery(st);
+	}
+	else
+		writeState(st);
+
+	const auto data { st.view() };
+	movie.startData.assign(data.begin(), data.end());
+
+	// The recording starts from the same restored state as the playback, instead of the live one.
+	if (restartMovie() != FileLoadResult::SuccessMovie)
+	{
+		stopMovie();
+		return false;
+	}
+
+	movie.system = System::Current();
+	movie.bootROM = mmu.isBootROMMapped;
+	movie.startCycle = cycleCounter;
+	movie.events.push_back({ cycleCounter, joypad.getInputState() });
+	movie.mode = InputMovie::Mode::Recording;
+
+	movieFilePath = filePath;
+	return true;
+}
+
+void GBCore::stopMovie()
+{
+	if (!movie.active())
+		return;
+
+	if (movie.recording())
+	{
+		movie.endCycle = cycleCounter;
+
+		if (std::ofstream st { movieFilePath, std::ios::out | std::ios::binary })
+			movie.write(st);
+	}
+
+	movie = {};
+	RTC::fixedUnixTime.reset();
+
+	if (speedFactor != 1 && cartridge.rtc != nullptr)
+		cartridge.rtc->enableFastForward(speedFactor);
+}
+
+FileLoadResult GBCore::loadMovie(std::istream& st)
+{
+	InputMovie newMovie{};
+
+	if (!newMovie.read(st))
+		return FileLoadResult::InvalidMovie;
+
+	movie = std::move(newMovie);
+
+	const auto result { restartMovie() };
+
+	if (result != FileLoadResult::SuccessMovie || System::Current() != movie.system || mmu.isBootROMMapped != movie.bootROM)
+	{
+		stopMovie();
+		return result == FileLoadResult::SuccessMovie ? FileLoadResult::InvalidMovie : result;
+	}
+
+	movie.mode = InputMovie::Mode::Playback;
+	return FileLoadResult::SuccessMovie;
+}
+
+FileLoadResult GBCore::restartMovie()
+{
+	RTC::fixedUnixTime = movie.rtcTime;
+
+	if (movie.start == MovieStart::SaveState)
+	{
+		memstream st { movie.startData };
+
+		if (!isSaveStateFile(st))
+			return FileLoadResult::InvalidMovie;
+
+		if (const auto result { loadState(st) }; result != FileLoadResult::SuccessSaveState)
+			return result;
+	}
+	else
+	{
+		if (!cartridge.loaded() || cartridge.getChecksum() != movie.romChecksum)
+		{
+			if (!validateAndLoadRom(FileUtils::nativePathFromUTF8(movie.romPath), movie.romChecksum))
+				return FileLoadResult::ROMNotFound;
 		}
 
-		cycleCounter += cpu.execute();
+		RngOps::seed(movie.rngSeed);
+
+		const bool runBootROM { appConfig::runBootROM };
+		appConfig::runBootROM = movie.bootROM;
+		reset(false);
+		appConfig::runBootROM = runBootROM;
+
+		if (!movie.startData.empty())
+		{
+			memstream st { movie.startData };
+
+			if (!cartridge.hasBattery || !cartridge.getMapper()->loadBattery(st))
+				return FileLoadResult::InvalidMovie;
+		}
 	}
 
-	cpuUsageCycles += frameCycles;
+	if (cartridge.rtc != nullptr)
+		cartridge.rtc->disableFastForward();
 
-	if (++frameCounter % 60 == 0)
+	// Inputs held at the start don't trigger the joypad interrupt.
+	if (!movie.events.empty())
+		joypad.setInputState(movie.events[0].state, false);
+
+	movie.nextEvent = 1;
+	return FileLoadResult::SuccessMovie;
+}
+
+uint64_t GBCore::applyMovieInputs()
+{
+	const auto& events { movie.events };
+
+	while (movie.nextEvent < events.size() && events[movie.nextEvent].cycle <= cycleCounter)
+		joypad.setInputState(events[movie.nextEvent++].state);
+
+	if (movie.nextEvent < events.size())
+		return events[movie.nextEvent].cycle;
+
+	if (cycleCounter < movie.endCycle)
+		return movie.endCycle;
+
+	movie.mode = InputMovie::Mode::Finished;
+	return UINT64_MAX;
+}
+
+void GBCore::addMovieKeyframe()
+{
+	// Boot ROM mapping is not a part of the GB state.
+	if (mmu.isBootROMMapped)
+		return;
+
+	const uint64_t lastCycle { movie.keyframes.empty() ? movie.startCycle : movie.keyframes.back().cycle };
+
+	if (!movie.keyframes.empty() && cycleCounter - lastCycle < static_cast<uint64_t>(InputMovie::KEYFRAME_INTERVAL) * CYCLES_PER_FRAME)
+		return;
+
+	std::ostringstream st{};
+	writeGBState(st);
+
+	const auto stateData { st.view() };
+	mz_ulong compressedSize { mz_compressBound(static_cast<mz_ulong>(stateData.size())) };
+
+	InputMovie::keyframe frame { cycleCounter, static_cast<uint32_t>(movie.events.size()), joypad.getInputState(), static_cast<uint32_t>(stateData.size()), {} };
+	frame.data.resize(compressedSize);
+
+	if (mz_compress(frame.data.data(), &compressedSize, reinterpret_cast<const unsigned char*>(stateData.data()), static_cast<mz_ulong>(stateData.size())) != MZ_OK)
+		return;
+
+	frame.data.resize(compressedSize);
+	movie.keyframes.push_back(std::move(frame));
+}
+
+bool GBCore::loadMovieKeyframe(const InputMovie::keyframe& frame)
+{
+	std::vector<uint8_t> buffer(frame.stateSize);
+	mz_ulong uncompressedSize { frame.stateSize };
+
+	// A state that decompresses to a different size than recorded is corrupt.
+	if (mz_uncompress(buffer.data(), &uncompressedSize, frame.data.data(), static_cast<mz_ulong>(frame.data.size())) != MZ_OK || uncompressedSize != frame.stateSize)
+		return false;
+
+	memstream st { buffer };
+	readGBState(st);
+
+	if (cartridge.rtc != nullptr)
+		cartridge.rtc->disableFastForward();
+
+	joypad.setInputState(frame.inputState, false);
+	movie.nextEvent = frame.eventIndex;
+	return true;
+}
+
+bool GBCore::seekMovie(uint32_t frame)
+{
+	if (!movieLoaded())
+		return false;
+
+	const uint64_t targetCycles { movie.startCycle + static_cast<uint64_t>(frame) * CYCLES_PER_FRAME };
+	const auto keyframe { movie.findKeyframe(targetCycles) };
+
+	// Running forward from the current position is fine if there is no closer keyframe, unless the user took over after the end.
+	const bool continueFromHere { movie.playing() && targetCycles >= cycleCounter && (keyframe == nullptr || keyframe->cycle <= cycleCounter) };
+
+	if (!continueFromHere)
 	{
-		cpuUsage = 100.f - ((static_cast<double>(cpu.haltCycleCount()) / cpuUsageCycles) * 100);
-		cpu.resetHaltCycleCount();
-		cpuUsageCycles = 0;
+		if (keyframe != nullptr)
+		{
+			if (!loadMovieKeyframe(*keyframe))
+				return false;
+		}
+		else if (restartMovie() != FileLoadResult::SuccessMovie)
+			return false;
+
+		movie.mode = InputMovie::Mode::Playback;
 	}
+
+	// Audio of the skipped part is discarded.
+	apu.beginCapture(false);
+
+	while (cycleCounter < targetCycles && !breakpointHit)
+	{
+		executeUntil<false>(std::min(targetCycles, cycleCounter + CYCLES_PER_FRAME));
+		apu.endFrame();
+	}
+
+	apu.endCapture();
+	return true;
+}
+
+AudioCapture GBCore::renderAudio(double seconds, bool captureStems)
+{
+	if (!executingProgram())
+		return {};
+
+	const auto frames { static_cast<uint64_t>(std::ceil(seconds * CYCLES_PER_SECOND / (static_cast<double>(CYCLES_PER_FRAME) * speedFactor))) };
+
+	apu.beginCapture(captureStems);
+
+	for (uint64_t i = 0; i < frames && !breakpointHit; i++)
+		emulateFrame();
+
+	return apu.endCapture();
 }
 
 void GBCore::stepComponents()
 {
 	cpu.executeTimer();
-	ppu->execute();
+
+	{
+		PROFILE_SCOPE(PPU);
+		ppu->execute();
+	}
+
 	mmu.execute();
 	serial.execute();
+	apu.addCycles(cpu.TcyclesPerM());
 }
 
 bool GBCore::isSaveStateFile(std::istream& st)
@@ -236,8 +614,25 @@ FileLoadResult GBCore::loadFile(std::istream& st, std::filesystem::path filePath
 		return FileLoadResult::FileError;
 
 	autoSave();
+	stopMovie();
+
 	const bool isSaveState { isSaveStateFile(st) };
 
+	if (!isSaveState)
+	{
+		st.clear();
+		st.seekg(0, std::ios::beg);
+
+		if (InputMovie::isMovieFile(st))
+		{
+			st.seekg(0, std::ios::beg);
+			return loadMovie(st);
+		}
+
+		st.clear();
+		st.seekg(0, std::ios::beg);
+	}
+
 	if (isSaveState)
 	{
 		const auto result { loadState(st) };
@@ -330,14 +725,33 @@ bool GBCore::loadROM(std::istream& st, const std::filesystem::path& filePath)
 	else if (!cartridge.loadROM(st))
 		return false;
 
+	initLoadedROM(filePath);
+	return true;
+}
+
+bool GBCore::loadSharedROM(const GBCore& other)
+{
+	stopMovie();
+
+	if (!cartridge.shareROM(other.cartridge))
+		return false;
+
+	initLoadedROM(other.romFilePath);
+	saveStateFolderPath = other.saveStateFolderPath;
+	return true;
+}
+
+void GBCore::initLoadedROM(const std::filesystem::path& filePath)
+{
 	currentSave = 0;
 	romFilePath = filePath;
 	reset(true);
 
+	if (pcProfiler.active())
+		startPCProfiler();
+
 	if (speedFactor != 1 && cartridge.rtc != nullptr)
 		cartridge.rtc->enableFastForward(speedFactor);
-
-	return true;
 }
 
 std::vector<uint8_t> GBCore::extractZippedROM(std::istream& st)
@@ -434,6 +848,7 @@ FileLoadResult GBCore::loadState(const std::filesystem::path& path)
 	if (!isSaveStateFile(st))
 		return FileLoadResult::CorruptSaveState;
 
+	stopMovie();
 	return loadState(st);
 }
 FileLoadResult GBCore::loadState(int num)
@@ -456,6 +871,8 @@ void GBCore::saveState(const std::filesystem::path& path) const
 	if (!std::filesystem::exists(saveStateFolderPath, err))
 		std::filesystem::create_directories(saveStateFolderPath, err);
 
+	PROFILE_SCOPE(SaveState);
+
 	std::ofstream st { path, std::ios::out | std::ios::binary };
 	if (!st) return;
 	writeState(st);
@@ -576,6 +993,8 @@ bool GBCore::validateAndLoadRom(const std::filesystem::path& romPath, uint8_t ch
 
 void GBCore::writeState(std::ostream& os) const
 {
+	PROFILE_SCOPE(SaveState);
+
 	std::ostringstream st{};
 
 	ST_WRITE(SAVE_STATE_VERSION);
@@ -640,6 +1059,8 @@ std::vector<uint8_t> GBCore::getStateData(std::istream& st)
 
 FileLoadResult GBCore::loadState(std::istream& is)
 {
+	PROFILE_SCOPE(SaveState);
+
 	const auto buffer { getStateData(is) };
 
 	if (buffer.empty())
@@ -711,9 +1132,10 @@ FileLoadResult GBCore::loadState(std::istream& is)
 	// For the first frame not to be as teared.
 	st.seekg(framebufDataOffset, std::ios::beg);
 	loadFrameBuffer(st, { ppu->backbufferPtr(), PPU::FRAMEBUFFER_SIZE });
+	frameChangeCount++;
 
 	if (drawCallback != nullptr)
-		drawCallback(ppu->backbufferPtr(), true);
+		drawCallback(ppu->backbufferPtr(), true, true);
 
 	return FileLoadResult::SuccessSaveState;
 }
@@ -759,6 +1181,144 @@ void GBCore::readGBState(std::istream& st)
 	cartridge.getMapper()->loadState(st);
 }
 
+std::array<GBCore::pagedRegion, 4> GBCore::pagedRegions()
+{
+	// Both WRAM and VRAM banks are paged on every system, unused pages are never written so they stay shared.
+	return
+	{ {
+		{ mmu.wramBanks, mmu.wramDirtyPages },
+		{ ppu->VRAM_BANK0, ppu->vramDirtyPages[0] },
+		{ ppu->VRAM_BANK1, ppu->vramDirtyPages[1] },
+		{ cartridge.ram, cartridge.getMapper()->ramDirtyPages }
+	} };
+}
+size_t GBCore::pagedRegionsPageCount()
+{
+	size_t count { 0 };
+
+	for (const auto& region : pagedRegions())
+		count += MemoryPages::pageCount(region.data.size());
+
+	return count;
+}
+
+bool GBCore::forkState(StateFork& fork)
+{
+	PROFILE_SCOPE(SaveState);
+
+	// Boot ROM mapping is not a part of the GB state.
+	if (!cartridge.loaded() || mmu.isBootROMMapped)
+		return false;
+
+	fork.system = System::Current();
+	fork.checksum = cartridge.getChecksum();
+
+	std::ostringstream st{};
+	writeForkState(st);
+
+	const auto data { st.view() };
+	fork.state.assign(data.begin(), data.end());
+
+	fork.pages.clear();
+	fork.pages.reserve(pagedRegionsPageCount());
+
+	for (auto& region : pagedRegions())
+	{
+		for (size_t i = 0; i < MemoryPages::pageCount(region.data.size()); i++)
+		{
+			const size_t ind { fork.pages.size() };
+			const bool dirty { ((region.dirtyPages >> i) & 1) != 0 };
+
+			if (!dirty && ind < forkPages.size())
+			{
+				fork.pages.push_back(forkPages[ind]);
+				continue;
+			}
+
+			const size_t offset { i * MemoryPages::PAGE_SIZE };
+			const size_t size { std::min<size_t>(MemoryPages::PAGE_SIZE, region.data.size() - offset) };
+
+			auto page { std::make_shared<MemoryPages::page>() };
+			std::copy_n(region.data.begin() + offset, size, page->begin());
+			fork.pages.push_back(std::move(page));
+		}
+
+		region.dirtyPages = 0;
+	}
+
+	forkPages = fork.pages;
+	return true;
+}
+
+bool GBCore::restoreFork(const StateFork& fork)
+{
+	PROFILE_SCOPE(SaveState);
+
+	if (!cartridge.loaded() || fork.checksum != cartridge.getChecksum())
+		return false;
+
+	if (System::Current() != fork.system)
+		return false;
+
+	if (fork.pages.size() != pagedRegionsPageCount())
+		return false;
+
+	// Paged memory is overwritten below, so it's not initialized.
+	reset(false, false, false, false);
+	mmu.isBootROMMapped = false;
+
+	size_t ind { 0 };
+
+	for (auto& region : pagedRegions())
+	{
+		for (size_t i = 0; i < MemoryPages::pageCount(region.data.size()); i++, ind++)
+		{
+			const bool dirty { ((region.dirtyPages >> i) & 1) != 0 };
+
+			if (!dirty && ind < forkPages.size() && forkPages[ind] == fork.pages[ind])
+				continue;
+
+			const size_t offset { i * MemoryPages::PAGE_SIZE };
+			const size_t size { std::min<size_t>(MemoryPages::PAGE_SIZE, region.data.size() - offset) };
+
+			std::copy_n(fork.pages[ind]->begin(), size, region.data.begin() + offset);
+		}
+
+		region.dirtyPages = 0;
+	}
+
+	forkPages = fork.pages;
+
+	memstream st { fork.state };
+	readForkState(st);
+	return true;
+}
+
+void GBCore::writeForkState(std::ostream& st) const
+{
+	ST_WRITE(cycleCounter);
+
+	cpu.saveState(st);
+	ppu->saveForkState(st);
+	mmu.saveForkState(st);
+	apu.saveState(st);
+	serial.saveState(st);
+	joypad.saveState(st);
+	cartridge.getMapper()->saveForkState(st);
+}
+void GBCore::readForkState(std::istream& st)
+{
+	ST_READ(cycleCounter);
+
+	cpu.loadState(st);
+	ppu->loadForkState(st);
+	mmu.loadForkState(st);
+	apu.loadState(st);
+	serial.loadState(st);
+	joypad.loadState(st);
+	cartridge.getMapper()->loadForkState(st);
+}
+
 bool GBCore::loadSaveStateThumbnail(const std::filesystem::path& path, std::span<uint8_t> framebuffer) const
 {
 	if (!cartridge.loaded())
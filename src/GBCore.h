@@ -5,11 +5,15 @@
 
 #include "MMU.h"
 #include "CPU/CPU.h"
+#include "CPU/cpuTracer.h"
 #include "PPU/PPUCore.h"
 #include "APU/APU.h"
 #include "Joypad.h"
 #include "SerialPort.h"
 #include "Cartridge.h"
+#include "avRecorder.h"
+#include "inputMovie.h"
+#include "pcProfiler.h"
 #include "appConfig.h"
 #include "Utils/fileUtils.h"
 
@@ -22,7 +26,9 @@ enum class FileLoadResult
 	ROMNotFound,
 	SuccessSaveState,
 	CorruptSaveState,
-	SaveStateVersionError
+	SaveStateVersionError,
+	SuccessMovie,
+	InvalidMovie
 };
 
 struct gameSharkCheat
@@ -55,6 +61,17 @@ struct gameGenieCheat
 	}
 };
 
+// Emulator state that shares unchanged 4 KiB pages of WRAM, VRAM and cartridge RAM with earlier forks, never includes the ROM.
+// Pages are immutable, so a fork can be restored on any core running the same ROM, on any thread.
+struct StateFork
+{
+	GBSystem system { GBSystem::DMG };
+	uint8_t checksum { 0 };
+
+	std::vector<uint8_t> state; // Everything except the paged memory.
+	std::vector<MemoryPages::pageRef> pages;
+};
+
 class GBCore
 {
 	friend class debugUI;
@@ -84,16 +101,69 @@ public:
 
 	inline void emulateFrame()
 	{
-		if (enableBreakpointChecks)
+		if (enableBreakpointChecks || pcProfiler.active() || cpuTracer.active()) [[unlikely]]
 			emulateFrameBase<true>();
 		else
 			emulateFrameBase<false>();
 	}
 
+	// Records every emulated frame together with the audio produced during it. Audio is taken before resampling,
+	// at the native rate, so both streams follow the emulation timeline exactly.
+	bool startAVRecording(const std::filesystem::path& filePath);
+	inline void stopAVRecording() { avRecorder.stop(); }
+	inline bool isAVRecording() const { return avRecorder.active(); }
+	inline float getAVRecordedSeconds() const { return avRecorder.recordedSeconds(); }
+
+	// Counts executed cycles per (ROM bank, address). Restarted with the new size when another ROM is loaded.
+	inline void startPCProfiler()
+	{
+		if (cartridge.loaded())
+			pcProfiler.start(cartridge.rom.size());
+	}
+	inline void stopPCProfiler() { pcProfiler.stop(); }
+	inline bool isPCProfiling() const { return pcProfiler.active(); }
+
+	// Bank, address, share of the profiled cycles and disassembly, for example "01:4A2F  12.34%  LD A,[HL+]".
+	std::string describeHotSpot(const PCProfiler::hotSpot& spot);
+
+	// Writes the CPU state before every executed instruction into a compressed binary trace, see CPUTracer::expandToText.
+	inline bool startCPUTrace(const std::filesystem::path& filePath) { return cpuTracer.start(filePath); }
+	inline void stopCPUTrace() { cpuTracer.stop(); }
+	inline bool isCPUTracing() const { return cpuTracer.active(); }
+	inline uint64_t getCPUTraceInstructions() const { return cpuTracer.recordedInstructions(); }
+
+	// Joypad changes are recorded on their exact cycle, together with the start state, RNG seed and RTC time, so the run replays bit-exactly.
+	// Movies are played by loading them with loadFile.
+	bool startMovieRecording(const std::filesystem::path& filePath, MovieStart start);
+	void stopMovie();
+	bool seekMovie(uint32_t frame);
+
+	inline bool isMovieRecording() const { return movie.recording(); }
+	inline bool isMoviePlaying() const { return movie.playing(); }
+	inline bool movieLoaded() const { return movie.active() && !movie.recording(); }
+
+	inline uint32_t getMovieFrame() const { return static_cast<uint32_t>((cycleCounter - movie.startCycle) / CYCLES_PER_FRAME); }
+	inline uint32_t getMovieLength() const { return static_cast<uint32_t>((movie.endCycle - movie.startCycle) / CYCLES_PER_FRAME); }
+
+	// Key input from the frontend. Ignored while a movie is playing.
+	inline void updateInput(int key, bool pressed)
+	{
+		if (movie.playing())
+			return;
+
+		joypad.update(key, pressed);
+
+		if (movie.recording())
+			movie.recordInput(cycleCounter, joypad.getInputState());
+	}
+
+	// Emulates the given number of seconds as fast as possible, and returns the audio output instead of playing it.
+	AudioCapture renderAudio(double seconds, bool captureStems = true);
+
 	inline bool executingBootROM() const { return mmu.isBootROMMapped; }
 	inline bool executingProgram() const { return cartridge.loaded() || mmu.isBootROMMapped; }
 
-	inline void setDrawCallback(void (*callback)(const uint8_t*, bool)) { drawCallback = callback; }
+	inline void setDrawCallback(void (*callback)(const uint8_t*, bool, bool)) { drawCallback = callback; }
 	inline void setBootRomExitCallback(void(*callback)()) { bootRomExitCallback = callback; }
 
 	static constexpr std::string_view SAVE_STATE_SIGNATURE = "MegaBoy Emulator Save State";
@@ -101,6 +171,17 @@ public:
 
 	static bool isSaveStateFile(std::istream& st);
 
+	// Raw GB state without the save state file wrapper, for fast in-memory snapshots of the same ROM.
+	inline void writeSnapshot(std::ostream& st) const { writeGBState(st); }
+	inline void readSnapshot(std::istream& st) { readGBState(st); }
+
+	// Copies only the pages written since the last fork or restore on this core, the rest is shared with that fork. Fails while boot ROM is executing.
+	bool forkState(StateFork& fork);
+
+	// Copies only the pages that differ from the last fork or restore on this core. Fails if the fork is from a different ROM or system.
+	// Never changes the global system type, so forks can be restored on many cores in parallel.
+	bool restoreFork(const StateFork& fork);
+
 	FileLoadResult loadFile(std::istream& st, std::filesystem::path filePath, bool loadBatteryOnRomload);
 
 	inline FileLoadResult loadFile(const std::filesystem::path& filePath, bool loadBatteryOnRomload)
@@ -109,6 +190,9 @@ public:
 		return loadFile(st, filePath, loadBatteryOnRomload);
 	}
 
+	// Loads the ROM another core is running without copying its data, for running many cores on the same ROM.
+	bool loadSharedROM(const GBCore& other);
+
 	bool runNoCartridgeBootROM(GBSystem bootSys);
 
 	inline void loadCurrentBatterySave() const
@@ -175,6 +259,8 @@ public:
 		if (!executingProgram())
 			return;
 
+		stopMovie();
+
 		if (cartridge.loaded())
 		{
 			if (resetBattery)
@@ -200,6 +286,7 @@ public:
 	}
 	inline void unloadCartridge()
 	{
+		stopMovie();
 		cartridge.unload();
 
 		if (!executingBootROM())
@@ -209,15 +296,40 @@ public:
 	constexpr void enableFastForward(int factor)
 	{
 		speedFactor = factor;
+		apu.setSpeedFactor(factor);
 
-		if (cartridge.rtc != nullptr)
+		// RTC slowdown depends on the host speed, so it's kept off while a movie is active.
+		if (cartridge.rtc != nullptr && !movie.active())
 			cartridge.rtc->enableFastForward(factor);
 	}
+	// Only every N-th frame is rendered and passed to the draw callback. PPU timing and interrupts of skipped frames stay exact.
+	constexpr void setFrameSkip(int ratio) { frameSkipRatio = std::max(ratio, 1); }
+	constexpr int getFrameSkip() const { return frameSkipRatio; }
+
+	// Incremented for every rendered frame that differs from the previous one, so static screens can be detected across several frames.
+	constexpr uint64_t getFrameChangeCount() const { return frameChangeCount; }
+
+	// Turbo mode runs whole frames back to back instead, the measured speed keeps audio and RTC close to real time.
+	static constexpr int MAX_TURBO_SPEED = 128;
+
+	constexpr void setTurboSpeed(int factor)
+	{
+		factor = std::clamp(factor, 1, MAX_TURBO_SPEED);
+		apu.setSpeedFactor(factor);
+
+		if (cartridge.rtc != nullptr && !movie.active())
+		{
+			cartridge.rtc->disableFastForward();
+			cartridge.rtc->enableFastForward(factor);
+		}
+	}
+
 	constexpr void disableFastForward()
 	{
 		speedFactor = 1;
+		apu.setSpeedFactor(1);
 
-		if (cartridge.rtc != nullptr)
+		if (cartridge.rtc != nullptr && !movie.active())
 			cartridge.rtc->disableFastForward();
 	}
 
@@ -236,8 +348,11 @@ public:
 	Joypad joypad { cpu };
 	SerialPort serial { cpu };
 	Cartridge cartridge { *this };
+	AVRecorder avRecorder;
+	PCProfiler pcProfiler;
+	CPUTracer cpuTracer;
 private:
-	void (*drawCallback)(const uint8_t* framebuffer, bool firstFrame) { nullptr };
+	void (*drawCallback)(const uint8_t* framebuffer, bool firstFrame, bool frameChanged) { nullptr };
 	void (*bootRomExitCallback)() { nullptr };
 
 	bool ppuDebugEnable { false };
@@ -245,7 +360,13 @@ private:
 	uint64_t cycleCounter { 0 };
 	int speedFactor { 1 };
 
+	int frameSkipRatio { 1 };
+	int frameSkipCounter { 0 };
+
 	uint64_t frameCounter { 0 };
+	uint64_t frameChangeCount { 0 };
+	uint64_t recordedFrameChangeCount { 0 };
+
 	uint64_t cpuUsageCycles { 0 };
 	float cpuUsage { 0.f };
 
@@ -259,9 +380,24 @@ private:
 	std::array<bool, 0x100> opcodeBreakpoints{};
 	bool enableBreakpointChecks { false };
 
-	template<bool checkBreakpoints>
+	InputMovie movie;
+	std::filesystem::path movieFilePath;
+
+	// The instrumented variant checks breakpoints and records the PC profile and CPU trace.
+	template<bool instrumented>
 	void emulateFrameBase();
 
+	template<bool instrumented>
+	void executeUntil(uint64_t targetCycles);
+
+	cpuTraceRecord makeTraceRecord();
+
+	FileLoadResult loadMovie(std::istream& st);
+	FileLoadResult restartMovie();
+	uint64_t applyMovieInputs();
+	void addMovieKeyframe();
+	bool loadMovieKeyframe(const InputMovie::keyframe& frame);
+
 	void stepComponents();
 
 	inline void setPPUDebugEnable(bool val)
@@ -275,7 +411,7 @@ private:
 		appConfig::updateConfigFile();
 	}
 
-	void reset(bool resetBattery, bool clearBuf = true, bool fullReset = true);
+	void reset(bool resetBattery, bool clearBuf = true, bool fullReset = true, bool initMemory = true);
 	void updatePPUSystem();
 
 	void loadBootROM();
@@ -287,7 +423,18 @@ private:
 		mmu.updateSystem();
 	}
 
+	// ROM bank mapped at the address, 0 outside of ROM.
+	inline uint16_t currentRomBank(uint16_t addr) const
+	{
+		if (addr >= PCProfiler::NON_ROM_START)
+			return 0;
+
+		const auto mapper { cartridge.getMapper() };
+		return addr < PCProfiler::ROM_BANK_SIZE ? mapper->getCurrentLowRomBank() : mapper->getCurrentRomBank();
+	}
+
 	bool loadROM(std::istream& st, const std::filesystem::path& filePath);
+	void initLoadedROM(const std::filesystem::path& filePath);
 	static std::vector<uint8_t> extractZippedROM(std::istream& st);
 
 	static uint64_t calculateHash(std::span<const uint8_t> data);
@@ -302,4 +449,19 @@ private:
 
 	void writeGBState(std::ostream& st) const;
 	void readGBState(std::istream& st);
+
+	struct pagedRegion
+	{
+		std::span<uint8_t> data;
+		MemoryPages::dirtyMask& dirtyPages;
+	};
+
+	// Memory matches these pages, except for the pages marked dirty since they were forked or restored.
+	std::vector<MemoryPages::pageRef> forkPages;
+
+	std::array<pagedRegion, 4> pagedRegions();
+	size_t pagedRegionsPageCount();
+
+	void writeForkState(std::ostream& st) const;
+	void readForkState(std::istream& st);
 };
\ No newline at end of file
@@ -22,26 +22,30 @@ void Joypad::reset()
 
 void Joypad::update(int key, bool action)
 {
-	const auto updateInput = [&](uint8_t& keyState, bool readGroup, int keyConfigOffset) -> bool
+	// Dpad binds are checked first.
+	for (int i : { 4, 5, 6, 7, 0, 1, 2, 3 })
 	{
-		for (int i = keyConfigOffset; i < 4 + keyConfigOffset; i++)
+		if (key == KeyBindManager::keyBinds[i])
 		{
-			if (key == KeyBindManager::keyBinds[i])
-			{
-				keyState = setBit(keyState, i - keyConfigOffset, !action);
+			setInputState(setBit(getInputState(), i, !action));
+			return;
+		}
+	}
+}
 
-				if (action && readGroup)
-					cpu.requestInterrupt(Interrupt::Joypad);
+void Joypad::setInputState(uint8_t state, bool requestInterrupt)
+{
+	const uint8_t newButtons { static_cast<uint8_t>(state & 0xF) };
+	const uint8_t newDpad { static_cast<uint8_t>(state >> 4) };
 
-				return true;
-			}
-		}
+	// Interrupt is requested when a line of a selected group goes low.
+	const bool pressed { (readButtons && (buttonState & ~newButtons)) || (readDpad && (dpadState & ~newDpad)) };
 
-		return false;
-	};
+	buttonState = newButtons;
+	dpadState = newDpad;
 
-	if (updateInput(dpadState, readDpad, 4)) return;
-	updateInput(buttonState, readButtons, 0);
+	if (pressed && requestInterrupt)
+		cpu.requestInterrupt(Interrupt::Joypad);
 }
 
 uint8_t Joypad::readInputReg() const
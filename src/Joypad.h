@@ -15,6 +15,10 @@ public:
 	void update(int key, bool action);
 	void reset();
 
+	// Pressed buttons in the low nibble and directions in the high nibble, active low (bit order matches the key binds).
+	inline uint8_t getInputState() const { return static_cast<uint8_t>(buttonState | (dpadState << 4)); }
+	void setInputState(uint8_t state, bool requestInterrupt = true);
+
 	uint8_t readInputReg() const;
 	void writeInputReg(uint8_t val);
 
@@ -2,6 +2,7 @@
 #include "GBCore.h"
 #include "defines.h"
 #include "Utils/rngOps.h"
+#include "Utils/profiler.h"
 
 MMU::MMU(GBCore& gb) : gb(gb) { updateSystem(); }
 
@@ -24,12 +25,15 @@ void MMU::updateSystem()
 	}
 }
 
-void MMU::reset()
+void MMU::reset(bool initRAM)
 {
 	s = {};
 	gbc = {};
 	dmgCompatSwitch = false;
 
+	if (!initRAM)
+		return;
+
 	for (int i = 0; i < 0x2000; i++)
 		wramBanks[i] = RngOps::gen8bit();
 
@@ -45,22 +49,35 @@ void MMU::reset()
 
 	for (uint8_t& i : hram)
 		i = RngOps::gen8bit();
+
+	wramDirtyPages = MemoryPages::ALL_DIRTY;
 }
 
-void MMU::saveState(std::ostream& st) const
+void MMU::saveState(std::ostream& st) const { save<true>(st); }
+void MMU::loadState(std::istream& st) { load<true>(st); }
+
+void MMU::saveForkState(std::ostream& st) const { save<false>(st); }
+void MMU::loadForkState(std::istream& st) { load<false>(st); }
+
+template <bool withWRAM>
+void MMU::save(std::ostream& st) const
 {
 	ST_WRITE(s);
 
 	if (System::IsCGBDevice(System::Current())) // Some registers in gbc struct still usable in DMG compat mode.
 		ST_WRITE(gbc); 
 
-	const int WRAMSize { System::Current() == GBSystem::CGB ? 0x8000 : 0x2000 };
+	if constexpr (withWRAM)
+	{
+		const int WRAMSize { System::Current() == GBSystem::CGB ? 0x8000 : 0x2000 };
+		st.write(reinterpret_cast<const char*>(wramBanks.data()), WRAMSize);
+	}
 
-	st.write(reinterpret_cast<const char*>(wramBanks.data()), WRAMSize);
 	ST_WRITE_ARR(hram);
 }
 
-void MMU::loadState(std::istream& st)
+template <bool withWRAM>
+void MMU::load(std::istream& st)
 {
 	ST_READ(s);
 
@@ -70,9 +87,13 @@ void MMU::loadState(std::istream& st)
 	if (System::IsCGBDevice(System::Current()))
 		ST_READ(gbc);
 
-	const int WRAMSize { System::Current() == GBSystem::CGB ? 0x8000 : 0x2000 };
+	if constexpr (withWRAM)
+	{
+		const int WRAMSize { System::Current() == GBSystem::CGB ? 0x8000 : 0x2000 };
+		st.read(reinterpret_cast<char*>(wramBanks.data()), WRAMSize);
+		wramDirtyPages = MemoryPages::ALL_DIRTY;
+	}
 
-	st.read(reinterpret_cast<char*>(wramBanks.data()), WRAMSize);
 	ST_READ_ARR(hram);
 }
 
@@ -114,11 +135,13 @@ void MMU::startDMATransfer()
 
 void MMU::executeDMA()
 {
+	PROFILE_SCOPE(DMA);
+
 	if (s.dma.delayCycles > 0 && !s.dma.restartRequest)
 		s.dma.delayCycles--;
 	else
 	{
-		gb.ppu->OAM[s.dma.cycles++] = (this->*readFunc)(s.dma.sourceAddr++);
+		gb.ppu->writeOAM(s.dma.cycles++, (this->*readFunc)(s.dma.sourceAddr++));
 
 		if (s.dma.restartRequest && s.dma.delayCycles-- == 0)
 		{
@@ -132,6 +155,8 @@ void MMU::executeDMA()
 
 void MMU::executeGHDMA()
 {
+	PROFILE_SCOPE(DMA);
+
 	gbc.ghdma.cycles += gb.cpu.TcyclesPerM();
 
 	if (gbc.ghdma.cycles >= GHDMA_BLOCK_CYCLES)
@@ -141,7 +166,7 @@ void MMU::executeGHDMA()
 
 		// Upper 3 bits of dest address are masked in place, actual address is not modified.
 		for (int i = 0; i < 0x10; i++)
-			gb.ppu->VRAM[(gbc.ghdma.destAddr++) & 0x1FFF] = (this->*readFunc)(gbc.ghdma.sourceAddr++);
+			gb.ppu->writeVRAM((gbc.ghdma.destAddr++) & 0x1FFF, (this->*readFunc)(gbc.ghdma.sourceAddr++));
 
 		// Since it's actually (transferLength - 1), transfer is over once it underflows to FF.
 		// Also when dest address overflows.
@@ -169,7 +194,7 @@ void MMU::write8(uint16_t addr, uint8_t val)
 	else if (addr <= 0x9FFF)
 	{
 		if (gb.ppu->canWriteVRAM())
-			gb.ppu->VRAM[addr - 0x8000] = val;
+			gb.ppu->writeVRAM(addr - 0x8000, val);
 	}
 	else if (addr <= 0xBFFF)
 	{
@@ -177,26 +202,30 @@ void MMU::write8(uint16_t addr, uint8_t val)
 	}
 	else if (addr <= 0xCFFF)
 	{
-		wramBanks[addr - 0xC000] = val;
+		writeWRAM(addr - 0xC000, val);
 	}
 	else if (addr <= 0xDFFF)
 	{
 		if constexpr (sys == GBSystem::CGB)
-			wramBanks[gbc.wramBank * 0x1000 + addr - 0xD000] = val;
+			writeWRAM(gbc.wramBank * 0x1000 + addr - 0xD000, val);
 		else
-			wramBanks[addr - 0xC000] = val;
+			writeWRAM(addr - 0xC000, val);
 	}
 	else if (addr <= 0xFDFF)
 	{
-		wramBanks[addr - 0xE000] = val;
+		writeWRAM(addr - 0xE000, val);
 	}
 	else if (addr <= 0xFE9F)
 	{
 		if (gb.ppu->canWriteOAM() && !dmaInProgress())
-			gb.ppu->OAM[addr - 0xFE00] = val;
+			gb.ppu->writeOAM(addr - 0xFE00, val);
 	}
 	else if (addr <= 0xFF7F)
 	{
+		// APU is executed lazily, so it has to catch up before its registers change.
+		if (addr >= 0xFF10 && addr <= 0xFF3F)
+			gb.apu.catchUp();
+
 		switch (addr)
 		{
 		case 0xFF00:
@@ -233,7 +262,7 @@ void MMU::write8(uint16_t addr, uint8_t val)
 			break;
 		case 0xFF40:
 			gb.ppu->setLCDEnable(getBit(val, 7));
-			gb.ppu->regs.LCDC = val;
+			gb.ppu->writeLCDC(val);
 			break;
 		case 0xFF41:
 		{
@@ -277,10 +306,12 @@ void MMU::write8(uint16_t addr, uint8_t val)
 		case 0xFF48:
 			gb.ppu->regs.OBP0 = val;
 			PPU::updatePalette(val, gb.ppu->OBP0);
+			gb.ppu->oamViewDirty = true;
 			break;
 		case 0xFF49:
 			gb.ppu->regs.OBP1 = val;
 			PPU::updatePalette(val, gb.ppu->OBP1);
+			gb.ppu->oamViewDirty = true;
 			break;
 		case 0xFF4A:
 			gb.ppu->regs.WY = val;
@@ -327,7 +358,10 @@ void MMU::write8(uint16_t addr, uint8_t val)
 			break;
 		case 0xFF6B:
 			if constexpr (sys == GBSystem::CGB)
+			{
 				gb.ppu->gbcRegs.OCPS.writePaletteRAM(val, gb.ppu->canWriteVRAM());
+				gb.ppu->oamViewDirty = true;
+			}
 			break;
 		case 0xFF70:
 			if constexpr (sys == GBSystem::CGB)
@@ -573,6 +607,9 @@ uint8_t MMU::read8(uint16_t addr) const
 	}
 	if (addr <= 0xFF7F)
 	{
+		if ((addr >= 0xFF10 && addr <= 0xFF3F) || addr == 0xFF76 || addr == 0xFF77)
+			gb.apu.catchUp();
+
 		switch (addr)
 		{
 		case 0xFF00:
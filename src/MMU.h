@@ -4,7 +4,9 @@
 #include <array>
 #include <iostream>
 #include <functional>
+#include <span>
 #include "gbSystem.h"
+#include "Utils/memoryPages.h"
 
 class GBCore;
 class Cartridge;
@@ -19,21 +21,31 @@ enum class GHDMAStatus
 class MMU
 {
 	friend class debugUI;
+	friend class GBCore;
 
 public:
 	explicit MMU(GBCore& gbCore);
 
 	void updateSystem();
-	void reset();
+	// WRAM and HRAM keep their contents if initRAM is false.
+	void reset(bool initRAM);
 
 	void saveState(std::ostream& st) const;
 	void loadState(std::istream& st);
 
+	// Same as above without WRAM, which state forks store in pages.
+	void saveForkState(std::ostream& st) const;
+	void loadForkState(std::istream& st);
+
 	inline void write8(uint16_t addr, uint8_t val) { (this->*writeFunc)(addr, val); }
 	inline uint8_t read8(uint16_t addr) const { return (this->*readFunc)(addr); }
 
 	void execute();
 
+	// DMG only has the first two banks.
+	inline std::span<const uint8_t> wramView() const { return { wramBanks.data(), System::IsCGBDevice(System::Current()) ? wramBanks.size() : 0x2000 }; }
+	inline std::span<const uint8_t> hramView() const { return hram; }
+
 	void executeDMA();
 	void executeGHDMA();
 
@@ -96,6 +108,19 @@ private:
 	std::array<uint8_t, 0x8000> wramBanks{};
 	std::array<uint8_t, 127> hram{};
 
+	MemoryPages::dirtyMask wramDirtyPages { MemoryPages::ALL_DIRTY };
+
+	inline void writeWRAM(uint16_t ind, uint8_t val)
+	{
+		wramBanks[ind] = val;
+		wramDirtyPages |= MemoryPages::pageBit(ind);
+	}
+
+	template <bool withWRAM>
+	void save(std::ostream& st) const;
+	template <bool withWRAM>
+	void load(std::istream& st);
+
 	constexpr bool dmaInProgress() const { return s.dma.transfer && s.dma.delayCycles == 0; }
 	void startDMATransfer();
 
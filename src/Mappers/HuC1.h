@@ -47,8 +47,7 @@ public:
 		else if (addr >= 0xA000 && addr <= 0xBFFF)
 		{
 			if (!s.ramEnable) return;
-			sramDirty = true;
-			ram[(s.ramBank & (cartridge.ramBanks - 1)) * 0x2000 + (addr - 0xA000)] = val;
+			writeRAM((s.ramBank & (cartridge.ramBanks - 1)) * 0x2000 + (addr - 0xA000), val);
 		}
 	}
 };
\ No newline at end of file
@@ -43,6 +43,17 @@ public:
 		rtc.loadState(st);
 	}
 
+	void saveForkState(std::ostream& st) const override
+	{
+		ST_WRITE(s);
+		rtc.saveForkState(st);
+	}
+	void loadForkState(std::istream& st) override
+	{
+		ST_READ(s);
+		rtc.loadForkState(st);
+	}
+
 	uint8_t read(uint16_t addr) const override
 	{
 		if (addr <= 0x3FFF)
@@ -98,7 +109,7 @@ public:
 			case 0x00:
 				break; // read-only RAM mode, do nothing.
 			case 0xA:
-				ram[(s.ramBank & (cartridge.ramBanks - 1)) * 0x2000 + (addr - 0xA000)] = val;
+				writeRAM((s.ramBank & (cartridge.ramBanks - 1)) * 0x2000 + (addr - 0xA000), val);
 				break;
 			case 0xB:
 				rtc.writeCommand(val);
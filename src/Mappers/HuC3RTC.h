@@ -156,6 +156,22 @@ public:
 		updateTime();
 	}
 
+	// Exact copy for state forks, not adjusted to the time passed since.
+	void saveForkState(std::ostream& st) const
+	{
+		ST_WRITE(lastUnixTime);
+		ST_WRITE(s);
+		ST_WRITE_ARR(regs);
+		ST_WRITE(secondsCounter);
+	}
+	void loadForkState(std::istream& st)
+	{
+		ST_READ(lastUnixTime);
+		ST_READ(s);
+		ST_READ_ARR(regs);
+		ST_READ(secondsCounter);
+	}
+
 	void reset()
 	{
 		s = {};
@@ -47,6 +47,7 @@ public:
 
 			st.read(reinterpret_cast<char*>(ram.data()), ram.size());
 			sramDirty = true;
+			ramDirtyPages = MemoryPages::ALL_DIRTY;
 		}
 
 		return true;
@@ -64,6 +65,15 @@ public:
 		loadBattery(st);
 	}
 
+	void saveForkState(std::ostream& st) const override
+	{
+		ST_WRITE(s);
+	}
+	void loadForkState(std::istream& st) override
+	{
+		ST_READ(s);
+	}
+
 	void reset(bool resetBattery) override
 	{
 		s = {};
@@ -72,7 +82,7 @@ public:
 protected:
 	Cartridge& cartridge;
 
-	const std::vector<uint8_t>& rom;
+	const std::span<const uint8_t>& rom;
 	std::vector<uint8_t>& ram;
 	T s;
 
@@ -80,5 +90,14 @@ protected:
 	{
 		for (uint8_t& i : ram)
 			i = RngOps::gen8bit();
+
+		ramDirtyPages = MemoryPages::ALL_DIRTY;
+	}
+
+	inline void writeRAM(uint32_t ind, uint8_t val)
+	{
+		ram[ind] = val;
+		sramDirty = true;
+		ramDirtyPages |= MemoryPages::pageBit(ind);
 	}
 };
\ No newline at end of file
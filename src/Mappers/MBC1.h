@@ -16,6 +16,9 @@ class MBC1 : public MBC<MBC1state>
 public:
 	using MBC::MBC;
 
+	uint16_t getCurrentRomBank() override { return static_cast<uint16_t>(s.highROMOffset / 0x4000); }
+	uint16_t getCurrentLowRomBank() override { return static_cast<uint16_t>(s.lowROMOffset / 0x4000); }
+
 	uint8_t read(uint16_t addr) const override
 	{
 		if (addr <= 0x3FFF)
@@ -61,8 +64,7 @@ public:
 		else if (addr <= 0xBFFF)
 		{
 			if (!cartridge.hasRAM || !s.ramEnable) return;
-			sramDirty = true;
-			ram[(s.RAMOffset + (addr - 0xA000)) & (ram.size() - 1)] = val;
+			writeRAM((s.RAMOffset + (addr - 0xA000)) & (ram.size() - 1), val);
 		}
 	}
 
@@ -42,8 +42,7 @@ public:
 		else if (addr >= 0xA000 && addr <= 0xBFFF)
 		{
 			if (!s.ramEnable) return;
-			ram[addr & 0x1FF] = val;
-			sramDirty = true;
+			writeRAM(addr & 0x1FF, val);
 		}
 	}
 };
\ No newline at end of file
@@ -39,6 +39,27 @@ public:
 		load<true>(st);
 	}
 
+	void saveForkState(std::ostream& st) const override
+	{
+		ST_WRITE(s);
+
+		if (rtc.has_value())
+		{
+			ST_WRITE(lastRTCAccessCycles);
+			rtc->saveForkState(st);
+		}
+	}
+	void loadForkState(std::istream& st) override
+	{
+		ST_READ(s);
+
+		if (rtc.has_value())
+		{
+			ST_READ(lastRTCAccessCycles);
+			rtc->loadForkState(st);
+		}
+	}
+
 	void reset(bool resetBattery) override
 	{
 		MBC::reset(resetBattery);
@@ -129,11 +150,10 @@ public:
 			{
 				updateRTC();
 				rtc->writeReg(val);
+				sramDirty = true;
 			}
 			else
-				ram[(s.ramBank & (cartridge.ramBanks - 1)) * 0x2000 + (addr - 0xA000)] = val;
-
-			sramDirty = true;
+				writeRAM((s.ramBank & (cartridge.ramBanks - 1)) * 0x2000 + (addr - 0xA000), val);
 		}
 	}
 
@@ -53,8 +53,7 @@ public:
 		else if (addr >= 0xA000 && addr <= 0xBFFF)
 		{
 			if (!cartridge.hasRAM || !s.ramEnable) return;
-			ram[(s.ramBank & (cartridge.ramBanks - 1)) * 0x2000 + (addr - 0xA000)] = val;
-			sramDirty = true;
+			writeRAM((s.ramBank & (cartridge.ramBanks - 1)) * 0x2000 + (addr - 0xA000), val);
 		}
 	}
 
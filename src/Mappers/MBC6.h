@@ -116,8 +116,7 @@ public:
 				{
 					if (s.ramEnable)
 					{
-						ram[(bank & (cartridge.ramBanks - 1)) * 0x1000 + (addr - baseAddr)] = val;
-						sramDirty = true;
+						writeRAM((bank & (cartridge.ramBanks - 1)) * 0x1000 + (addr - baseAddr), val);
 					}
 				};
 
@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <iostream>
 #include "RTC.h"
+#include "../Utils/memoryPages.h"
 
 struct MBCBase
 {
@@ -13,13 +14,21 @@ struct MBCBase
 	virtual void saveState(std::ostream& st) const = 0;
 	virtual void loadState(std::istream& st) = 0;
 
+	// Same as above without cartridge RAM, which state forks store in pages.
+	virtual void saveForkState(std::ostream& st) const = 0;
+	virtual void loadForkState(std::istream& st) = 0;
+
 	virtual void saveBattery(std::ostream& st) const = 0;
 	virtual bool loadBattery(std::istream& st) = 0;
 
 	virtual void reset(bool resetBattery) = 0;
 
 	virtual uint16_t getCurrentRomBank() = 0;
+
+	// Bank mapped at 0000-3FFF, only MBC1 in banking mode 1 maps a different one.
+	virtual uint16_t getCurrentLowRomBank() { return 0; }
 	virtual RTC* getRTC() { return nullptr; }
 
 	bool sramDirty { false };
+	MemoryPages::dirtyMask ramDirtyPages { MemoryPages::ALL_DIRTY };
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <chrono>
+#include <optional>
 
 class RTC
 {
@@ -7,9 +8,15 @@ public:
 	virtual void enableFastForward(int speedFactor) {};
 	virtual void disableFastForward() {};
 
+	// Used instead of the host clock while set, so runs can be reproduced.
+	static inline std::optional<uint64_t> fixedUnixTime{};
+
 protected:
 	inline uint64_t getUnixTime() const
 	{
+		if (fixedUnixTime) [[unlikely]]
+			return *fixedUnixTime;
+
 		return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 	}
 };
\ No newline at end of file
@@ -206,6 +206,18 @@ public:
 		return true;
 	}
 
+	// Exact copy for state forks, not adjusted to the time passed since.
+	void saveForkState(std::ostream& st) const
+	{
+		ST_WRITE(s);
+		ST_WRITE(lastUnixTime);
+	}
+	void loadForkState(std::istream& st)
+	{
+		ST_READ(s);
+		ST_READ(lastUnixTime);
+	}
+
 	inline void reset() 
 	{
 		s = {};
@@ -6,15 +6,23 @@
 #include "keyBindManager.h"
 #include "debugUI.h"
 #include "resources.h"
+#include "benchmark.h"
 #include "Utils/Shader.h"
 #include "Utils/fileUtils.h"
 #include "Utils/glFunctions.h"
 #include "Utils/memstream.h"
+#include "Utils/tripleBuffer.h"
+#include "Utils/framePacer.h"
+#include "Utils/profiler.h"
+#include "Utils/spscRing.h"
 
 #include <iostream>
 #include <filesystem>
 #include <span>
 #include <map>
+#include <mutex>
+#include <atomic>
+#include <cmath>
 
 #include <ImGUI/imgui.h>
 #include <ImGUI/imgui_internal.h>
@@ -68,6 +76,97 @@ Shader lcdShader{};
 
 Shader* currentShader{ };
 std::array<uint32_t, 2> gbTextures{};
+int identicalFrameUploads { 0 }; // Same frame uploaded N times in a row, once it's in both textures there is nothing to upload.
+
+// Emulation runs on its own thread paced by emulated time, so vsync or UI stalls don't delay it.
+// The main thread holds emulationMutex while accessing gb, while finished frames and joypad input are passed without locking.
+std::recursive_mutex emulationMutex;
+std::atomic<int> mainThreadLockRequests { 0 };
+
+// Turbo mode takes the lock again right after releasing it, so it yields while the main thread is waiting.
+class mainThreadLock
+{
+public:
+    mainThreadLock()
+    {
+        mainThreadLockRequests++;
+        emulationMutex.lock();
+        mainThreadLockRequests--;
+    }
+    ~mainThreadLock() { emulationMutex.unlock(); }
+
+    mainThreadLock(const mainThreadLock&) = delete;
+    mainThreadLock& operator=(const mainThreadLock&) = delete;
+};
+
+struct presentedFrame
+{
+    std::array<uint8_t, PPU::FRAMEBUFFER_SIZE> pixels;
+    bool firstFrame;
+    bool frameChanged;
+};
+
+TripleBuffer<presentedFrame> frameHandoff;
+bool pendingFirstFrame { false }, pendingFrameChanged { false };
+std::atomic<bool> gbTextureClearRequested { false };
+
+// Core state shown by the UI, copied once per UI frame. ImGui is built without holding emulationMutex, only actions that change the core take it.
+struct coreUIState
+{
+    bool executingProgram { false };
+    bool executingBootROM { false };
+    bool cartridgeLoaded { false };
+    bool hasBattery { false };
+    bool canSaveState { false };
+    bool emulationPaused { false };
+    bool breakpointHit { false };
+    int saveNum { 0 };
+    std::string gameTitle;
+    GBSystem system { GBSystem::DMG };
+
+    bool audioRecording { false };
+    float audioRecordedSeconds { 0.f };
+    bool avRecording { false };
+    float avRecordedSeconds { 0.f };
+    bool cpuTracing { false };
+    uint64_t cpuTraceInstructions { 0 };
+
+    bool movieRecording { false };
+    bool movieLoaded { false };
+    bool moviePlaying { false };
+    uint32_t movieFrame { 0 };
+    uint32_t movieLength { 0 };
+};
+
+coreUIState coreState;
+
+struct keyEvent
+{
+    int key;
+    bool pressed;
+};
+
+SPSCRing<keyEvent, 64> keyEvents;
+
+double gbExecuteTimes { 0.0 };
+int gbFrameCount { 0 };
+
+#ifndef EMSCRIPTEN
+std::thread emulationThread;
+std::atomic<bool> exitEmulationThread { false };
+
+// Emulation stops while the window is minimized, the main loop is blocked waiting for events then.
+std::atomic<bool> windowIconified { false };
+
+FramePacer emulationPacer, renderPacer;
+
+// Emulation runs flat out while fast forwarding, only the newest frame is presented.
+std::atomic<bool> turboMode { false };
+
+// Measured from vsynced buffer swaps, starts at the monitor's reported refresh rate.
+double displayRefreshPeriod { GBCore::FRAME_RATE };
+std::atomic<double> emulationFramePeriod { GBCore::FRAME_RATE };
+#endif
 
 const std::vector<uint8_t> whiteBG(PPU::FRAMEBUFFER_SIZE, 255);
 
@@ -75,12 +174,16 @@ bool glScreenshotRequested { false };
 bool fileDialogOpen { false };
 
 #ifndef EMSCRIPTEN
-constexpr nfdnfilteritem_t openFilterItem[] { { N_STR("Game ROM/Save"), N_STR("gb,gbc,zip,sav,mbs,bin") } };
+constexpr nfdnfilteritem_t openFilterItem[] { { N_STR("Game ROM/Save"), N_STR("gb,gbc,zip,sav,mbs,mbm,bin") } };
 constexpr nfdnfilteritem_t saveStateFilterItem[] { { N_STR("Save State"), N_STR("mbs") } };
 constexpr nfdnfilteritem_t batterySaveFilterItem[] { { N_STR("Battery Save"), N_STR("sav") } };
 constexpr nfdnfilteritem_t audioSaveFilterItem[] { { N_STR("WAV File"), N_STR("wav") } };
+constexpr nfdnfilteritem_t flacSaveFilterItem[] { { N_STR("FLAC File"), N_STR("flac") } };
+constexpr nfdnfilteritem_t videoSaveFilterItem[] { { N_STR("AVI File"), N_STR("avi") } };
+constexpr nfdnfilteritem_t movieFilterItem[] { { N_STR("Input Movie"), N_STR("mbm") } };
+constexpr nfdnfilteritem_t cpuTraceFilterItem[] { { N_STR("CPU Trace"), N_STR("mbt") } };
 #else
-constexpr const char* openFilterItem { ".gb,.gbc,.zip,.sav,.mbs,.bin" };
+constexpr const char* openFilterItem { ".gb,.gbc,.zip,.sav,.mbs,.mbm,.bin" };
 
 double devicePixelRatio{};
 bool emscripten_saves_syncing { false };
@@ -97,6 +200,7 @@ float fadeTime { 0.0f };
 
 bool fastForwarding { false }, fastForwardChangeFlag { false };
 constexpr int FAST_FORWARD_SPEED = 5;
+double achievedSpeed { 1.0 };
 
 bool lockVSyncSetting { false };
 
@@ -162,13 +266,32 @@ void setEmulationPaused(bool val)
     gb.emulationPaused = val;
     updateWindowTitle();
 }
+bool turboActive()
+{
+#ifdef EMSCRIPTEN
+    return false;
+#else
+    return turboMode;
+#endif
+}
 void setFastForwarding(bool val)
 {        
-	if (val)
+#ifdef EMSCRIPTEN
+    const bool turbo { false };
+#else
+    const bool turbo { val && appConfig::turboFastForward };
+    turboMode = turbo;
+#endif
+
+	if (val && !turbo)
 		gb.enableFastForward(FAST_FORWARD_SPEED);
 	else
 		gb.disableFastForward();
 
+	// Only one of FAST_FORWARD_SPEED frames emulated per update is shown anyway, so others don't need to be rendered.
+	// Turbo mode adjusts it to the measured speed.
+	gb.setFrameSkip(val && !turbo ? FAST_FORWARD_SPEED : 1);
+
 	fastForwarding = val;
 	fastForwardChangeFlag = true;
 }
@@ -270,6 +393,8 @@ bool loadFile(std::istream& st, const std::filesystem::path& filePath)
         return handleFileError("ROM Not Found! Load the ROM First.");
     case FileLoadResult::FileError:        
         return handleFileError("Error Reading the File!");
+    case FileLoadResult::InvalidMovie:
+        return handleFileError("Error Loading the Input Movie!");
     case FileLoadResult::SuccessROM: 
     {
 #ifdef EMSCRIPTEN
@@ -304,6 +429,7 @@ bool loadFile(std::istream& st, const std::filesystem::path& filePath)
         return handleFileSuccess();
     }
     case FileLoadResult::SuccessSaveState:
+    case FileLoadResult::SuccessMovie:
         return handleFileSuccess();
     }
 
@@ -428,22 +554,67 @@ void resetFade()
     fadeEffectActive = false; 
 }
 
-void drawCallback(const uint8_t* framebuffer, bool firstFrame)
+// Runs on the emulation thread, or on the main thread with emulationMutex held. Textures are updated by uploadPresentedFrame.
+void drawCallback(const uint8_t* framebuffer, bool firstFrame, bool frameChanged)
 {
-    OpenGL::updateTexture(gbTextures[0], PPU::SCR_WIDTH, PPU::SCR_HEIGHT, framebuffer);
+    // Flags of a frame the main thread didn't pick up carry over to the next one, so it doesn't miss a change.
+    if (!frameHandoff.pending())
+        pendingFirstFrame = pendingFrameChanged = false;
 
-    if (firstFrame)
-        OpenGL::updateTexture(gbTextures[1], PPU::SCR_WIDTH, PPU::SCR_HEIGHT, framebuffer);
-    else
-        std::swap(gbTextures[0], gbTextures[1]);
+    pendingFirstFrame |= firstFrame;
+    pendingFrameChanged |= frameChanged;
 
-    debugUI::signalVBlank();
+    auto& frame { frameHandoff.back() };
+    std::copy_n(framebuffer, PPU::FRAMEBUFFER_SIZE, frame.pixels.begin());
+    frame.firstFrame = pendingFirstFrame;
+    frame.frameChanged = pendingFrameChanged;
+
+    frameHandoff.publish();
 }
 
 void clearGBTexture()
 {
     for (auto t : gbTextures)
         OpenGL::updateTexture(t, PPU::SCR_WIDTH, PPU::SCR_HEIGHT, whiteBG.data());
+
+    identicalFrameUploads = 0;
+
+    // Drop a frame published before the clear.
+    frameHandoff.consume();
+}
+
+void uploadPresentedFrame()
+{
+    PROFILE_SCOPE(TextureUpload);
+
+    if (gbTextureClearRequested.exchange(false))
+        clearGBTexture();
+
+    const auto* frame { frameHandoff.consume() };
+
+    if (frame == nullptr)
+        return;
+
+    if (!frame->firstFrame && !frame->frameChanged && identicalFrameUploads >= static_cast<int>(gbTextures.size()))
+    {
+        debugUI::signalVBlank();
+        return;
+    }
+
+    OpenGL::updateTexture(gbTextures[0], PPU::SCR_WIDTH, PPU::SCR_HEIGHT, frame->pixels.data());
+
+    if (frame->firstFrame)
+    {
+        OpenGL::updateTexture(gbTextures[1], PPU::SCR_WIDTH, PPU::SCR_HEIGHT, frame->pixels.data());
+        identicalFrameUploads = static_cast<int>(gbTextures.size());
+    }
+    else
+    {
+        std::swap(gbTextures[0], gbTextures[1]);
+        identicalFrameUploads = frame->frameChanged ? 1 : identicalFrameUploads + 1;
+    }
+
+    debugUI::signalVBlank();
 }
 
 void handleCartridgeUnload()
@@ -460,10 +631,11 @@ void handleCartridgeUnload()
 }
 
 // To clear the screen in no cartridge boot rom execute mode (for unofficial boot roms which don't do cartridge header checks and always unmap itself).
+// Called on the emulation thread, so the texture is cleared by the main thread.
 void bootRomExitCallback()
 {
     if (!gb.cartridge.loaded())
-        clearGBTexture();
+        gbTextureClearRequested = true;
 }
 
 // For new palette to be applied on screen even if emulation is paused.
@@ -601,13 +773,11 @@ void rescaleWindow()
 #ifndef EMSCRIPTEN
 std::filesystem::path saveFileDialog(const std::string& defaultName, const nfdnfilteritem_t* filter)
 {
-    APU::isMainThreadBlocked = true;
     fileDialogOpen = true;
 
     NFD::UniquePathN outPath;
     const auto result { NFD::SaveDialog(outPath, filter, 1, nullptr, FileUtils::nativePathFromUTF8(defaultName).c_str()) };
 
-    APU::isMainThreadBlocked = false;
     fileDialogOpen = false;
 
     return result == NFD_OKAY ? outPath.get() : std::filesystem::path();
@@ -615,13 +785,11 @@ std::filesystem::path saveFileDialog(const std::string& defaultName, const nfdnf
 
 std::filesystem::path openFileDialog(const nfdnfilteritem_t* filter)
 {
-    APU::isMainThreadBlocked = true;
     fileDialogOpen = true;
 
     NFD::UniquePathN outPath;
     const auto result { NFD::OpenDialog(outPath, filter, 1) };
 
-    APU::isMainThreadBlocked = false;
     fileDialogOpen = false;
 
     return result == NFD_OKAY ? outPath.get() : std::filesystem::path();
@@ -837,6 +1005,7 @@ void renderSaveStatesGUI()
 
     for (int i = 1; i < NUM_SAVE_STATES; i++)
     {
+        // Save folder only changes on the main thread, thumbnails are read without the lock.
         const auto saveStatePath { gb.getSaveStatePath(i) };
 
         std::error_code err;
@@ -871,7 +1040,7 @@ void renderSaveStatesGUI()
 
         const auto imageSize { ImVec2(static_cast<int>(PPU::SCR_WIDTH * scaleFactor), static_cast<int>(PPU::SCR_HEIGHT * scaleFactor)) };
 
-        if (gb.getSaveNum() == i)
+        if (coreState.saveNum == i)
         {
             constexpr auto lightGolden { ImVec4(1.0f, 0.92f, 0.5f, 1.0f) };
             constexpr auto golden { ImVec4(1.0f, 0.84f, 0.0f, 1.0f) };
@@ -887,7 +1056,7 @@ void renderSaveStatesGUI()
 			showSaveStatePopUp = true;
         }
 
-        if (gb.getSaveNum() == i)
+        if (coreState.saveNum == i)
             ImGui::PopStyleColor(3);
 
         ImGui::Spacing();
@@ -937,6 +1106,7 @@ void renderSaveStatesGUI()
 
             if (ImGui::Button("Load", buttonSize))
             {
+                mainThreadLock lock;
                 loadState(selectedSaveState);
                 showSaveStatePopUp = false;
             }
@@ -945,6 +1115,8 @@ void renderSaveStatesGUI()
 
             if (ImGui::Button("Copy", buttonSize))
             {
+                mainThreadLock lock;
+
                 // Instead of passing the number pass the path, so save state is just copied, without becoming the active one.
                 if (gb.loadState(saveStatePath) == FileLoadResult::SuccessSaveState)
                     debugUI::signalSaveStateChange();
@@ -961,7 +1133,7 @@ void renderSaveStatesGUI()
 
             if (ImGui::Button("Export", buttonSize))
             {
-                const auto filename { gb.gameTitle + " - Save " + std::to_string(selectedSaveState) + ".mbs" };
+                const auto filename { coreState.gameTitle + " - Save " + std::to_string(selectedSaveState) + ".mbs" };
 #ifdef EMSCRIPTEN
                 downloadFile(saveStatePath.c_str(), filename.c_str());
 #else
@@ -985,8 +1157,9 @@ void renderSaveStatesGUI()
 
             if (ImGui::Button("Delete", buttonSize))
             {
-                if (gb.getSaveNum() == selectedSaveState)
+                if (coreState.saveNum == selectedSaveState)
                 {
+                    mainThreadLock lock;
                     gb.unbindSaveState();
                     appConfig::saveStateNum = 0;
                     appConfig::updateConfigFile();
@@ -1002,6 +1175,7 @@ void renderSaveStatesGUI()
 
             if (ImGui::Button("Save To", buttonSize))
             {
+                mainThreadLock lock;
                 saveState(selectedSaveState);
                 showSaveStatePopUp = false;
             }
@@ -1168,6 +1342,8 @@ void renderCheatsGUI()
 
 void renderImGUI() 
 {
+    PROFILE_SCOPE(ImGui);
+
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -1193,48 +1369,64 @@ void renderImGUI()
 #ifdef EMSCRIPTEN
                 openFileDialog(openFilterItem);
 #else
+                // Dialogs are open without the lock, so emulation keeps running behind them.
                 const auto result { openFileDialog(openFilterItem) };
 
                 if (!result.empty())
+                {
+                    mainThreadLock lock;
                     loadFile(result);
+                }
 #endif
             }
-            if (gb.cartridge.loaded())
+            if (coreState.cartridgeLoaded)
             {
                 if (ImGui::MenuItem("View Save States"))
                     saveStatesWindowOpen = true;
 
-                if (gb.canSaveStateNow())
+                if (coreState.canSaveState)
                 {
                     if (ImGui::MenuItem("Export State"))
                     {
-                        const std::string filename { gb.gameTitle + " - Save State.mbs" };
+                        const std::string filename { coreState.gameTitle + " - Save State.mbs" };
 #ifdef EMSCRIPTEN
                         std::ostringstream st;
-                        gb.saveState(st);
+                        {
+                            mainThreadLock lock;
+                            gb.saveState(st);
+                        }
                         downloadFile(st.view(), filename.c_str());
 #else
                         const auto result { saveFileDialog(filename, saveStateFilterItem) };
 
                         if (!result.empty())
+                        {
+                            mainThreadLock lock;
                             gb.saveState(result);
+                        }
 #endif
                     }
                 }
-                if (gb.cartridge.hasBattery)
+                if (coreState.hasBattery)
                 {
                     if (ImGui::MenuItem("Export Battery"))
                     {
-                        const std::string filename { gb.gameTitle + " - Battery Save.sav" };
+                        const std::string filename { coreState.gameTitle + " - Battery Save.sav" };
 #ifdef EMSCRIPTEN
                         std::ostringstream st;
-                        gb.saveBattery(st);
+                        {
+                            mainThreadLock lock;
+                            gb.saveBattery(st);
+                        }
                         downloadFile(st.view(), filename.c_str());
 #else
                         const auto result { saveFileDialog(filename, batterySaveFilterItem) };
 
                         if (!result.empty())
+                        {
+                            mainThreadLock lock;
                             gb.saveBattery(result);
+                        }
 #endif
                     }
                 }
@@ -1250,13 +1442,13 @@ void renderImGUI()
 #endif
             checkBootROMLoaded();
 
-            bool bootRomsLoaded { gb.cartridge.loaded() ?
-                                  (System::Current() == GBSystem::DMG ? dmgBootLoaded : cgbBootLoaded) : (dmgBootLoaded || cgbBootLoaded) };
+            bool bootRomsLoaded { coreState.cartridgeLoaded ?
+                                  (coreState.system == GBSystem::DMG ? dmgBootLoaded : cgbBootLoaded) : (dmgBootLoaded || cgbBootLoaded) };
 
             if (!bootRomsLoaded)
             {
-                const std::string tooltipText { gb.cartridge.loaded() ?
-                                                (System::Current() == GBSystem::DMG ? "Drop 'dmg_boot.bin'" : "Drop 'cgb_boot.bin'") :
+                const std::string tooltipText { coreState.cartridgeLoaded ?
+                                                (coreState.system == GBSystem::DMG ? "Drop 'dmg_boot.bin'" : "Drop 'cgb_boot.bin'") :
                                                 "Drop 'dmg_boot.bin' or 'cgb_boot.bin'" };
 
                 ImGui::BeginDisabled();
@@ -1327,6 +1519,18 @@ void renderImGUI()
                 ImGui::EndDisabled();
             }
 
+#ifndef EMSCRIPTEN
+            if (!appConfig::vsync) ImGui::BeginDisabled();
+
+            if (ImGui::Checkbox("Sync to Refresh Rate", &appConfig::syncToRefreshRate))
+                appConfig::updateConfigFile();
+
+            if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+                ImGui::SetTooltip("Runs emulation at the display's refresh rate when it's within 0.75%% of 59.73 Hz.\nAvoids repeated or skipped frames, needs VSync.");
+
+            if (!appConfig::vsync) ImGui::EndDisabled();
+#endif
+
             if (ImGui::Checkbox("Screen Ghosting (Blending)", &appConfig::blending))
                 appConfig::updateConfigFile();
 
@@ -1364,6 +1568,7 @@ void renderImGUI()
 
             if (ImGui::Checkbox("GBC Color Correction", &appConfig::gbcColorCorrection))
             {
+                mainThreadLock lock;
                 updateColorCorrection();
                 appConfig::updateConfigFile();
             }
@@ -1375,6 +1580,7 @@ void renderImGUI()
 
             if (ImGui::Combo("##Filter", &appConfig::filter, filters.data(), filterCount))
             {
+                mainThreadLock lock;
                 updateSelectedFilter();
                 appConfig::updateConfigFile();
             }
@@ -1407,6 +1613,7 @@ void renderImGUI()
                 else
                     customPaletteOpen = false;
 
+                mainThreadLock lock;
                 updateSelectedPalette();
                 appConfig::updateConfigFile();
             }
@@ -1426,6 +1633,7 @@ void renderImGUI()
                             static_cast<uint8_t>(colors[i][2] * 255)
                         };
 
+                        mainThreadLock lock;
                         refreshDMGPaletteColors(tempCustomPalette);
                         PPU::CUSTOM_PALETTE[i] = tempCustomPalette[i];
                         appConfig::updateConfigFile();
@@ -1438,6 +1646,7 @@ void renderImGUI()
 
                 if (ImGui::Button("Reset to Default"))
                 {
+                    mainThreadLock lock;
                     refreshDMGPaletteColors(PPU::DEFAULT_CUSTOM_PALETTE);
                     PPU::CUSTOM_PALETTE = PPU::DEFAULT_CUSTOM_PALETTE;
                     updateColors();
@@ -1462,49 +1671,104 @@ void renderImGUI()
             ImGui::PushItemFlag(ImGuiItemFlags_NoTabStop, true);
 
             if (ImGui::SliderInt("Volume", &volume, 0, 100))
+            {
+                mainThreadLock lock;
                 gb.apu.volume = static_cast<float>(volume / 100.0);
+            }
+
+            ImGui::PopItemFlag();
+
+            ImGui::SeparatorText("Output");
+
+            constexpr std::array sampleRates { 22050, 44100, 48000, 96000 };
+            constexpr std::array sampleRateNames { "22050 Hz", "44100 Hz", "48000 Hz", "96000 Hz" };
+
+            const auto rateIt { std::find(sampleRates.begin(), sampleRates.end(), appConfig::audioSampleRate) };
+            int rateInd { rateIt == sampleRates.end() ? -1 : static_cast<int>(rateIt - sampleRates.begin()) };
+
+            if (ImGui::Combo("Sample Rate", &rateInd, sampleRateNames.data(), static_cast<int>(sampleRateNames.size())))
+            {
+                appConfig::audioSampleRate = sampleRates[rateInd];
+
+                mainThreadLock lock;
+                gb.apu.setSampleRate(static_cast<uint32_t>(appConfig::audioSampleRate));
+                appConfig::updateConfigFile();
+            }
+
+            constexpr std::array resamplers { "Fast", "Balanced", "Best" };
+
+            if (ImGui::Combo("Resampler", &appConfig::audioResampler, resamplers.data(), static_cast<int>(resamplers.size())))
+            {
+                mainThreadLock lock;
+                gb.apu.setResamplerQuality(static_cast<ResamplerQuality>(appConfig::audioResampler));
+                appConfig::updateConfigFile();
+            }
+
+            ImGui::PushItemFlag(ImGuiItemFlags_NoTabStop, true);
+
+            if (ImGui::SliderInt("Latency", &appConfig::audioLatency, 10, 150, "%d ms"))
+            {
+                mainThreadLock lock;
+                gb.apu.setTargetLatency(appConfig::audioLatency);
+            }
+
+            if (ImGui::IsItemDeactivatedAfterEdit())
+                appConfig::updateConfigFile();
 
             ImGui::PopItemFlag();
 
             ImGui::SeparatorText("Misc.");
 
-            if (gb.apu.isRecording)
+            if (coreState.audioRecording)
             {
                 if (ImGui::Button("Stop Recording"))
                 {
-                    gb.apu.stopRecording();
+                    {
+                        mainThreadLock lock;
+                        gb.apu.stopRecording();
+                    }
 #ifdef EMSCRIPTEN
-                    downloadFile("recording.wav", "MegaBoy - Recording.wav");
+                    const std::string recordingFile { appConfig::recordFLAC ? "recording.flac" : "recording.wav" };
+                    downloadFile(recordingFile.c_str(), appConfig::recordFLAC ? "MegaBoy - Recording.flac" : "MegaBoy - Recording.wav");
                     std::error_code err;
-                    std::filesystem::remove("recording.wav", err);
+                    std::filesystem::remove(recordingFile, err);
 #endif
                 }
 
                 ImGui::SameLine();
 
-                const auto minutes { static_cast<int>(gb.apu.recordedSeconds) / 60 };
-                const auto seconds { static_cast<int>(gb.apu.recordedSeconds) % 60 };
-                ImGui::Text("%d:%02d", minutes, seconds);
+                const auto recordedSeconds { static_cast<int>(coreState.audioRecordedSeconds) };
+                ImGui::Text("%d:%02d", recordedSeconds / 60, recordedSeconds % 60);
             }
             else
             {
                 if (ImGui::Button("Start Recording"))
                 {
+                    const auto format { appConfig::recordFLAC ? RecordingFormat::FLAC : RecordingFormat::WAV };
 #ifdef EMSCRIPTEN
-                    gb.apu.startRecording("recording.wav");
+                    mainThreadLock lock;
+                    gb.apu.startRecording(appConfig::recordFLAC ? "recording.flac" : "recording.wav", format);
 #else
-                    const auto result { saveFileDialog("MegaBoy - Recording", audioSaveFilterItem) };
+                    const auto result { saveFileDialog("MegaBoy - Recording", appConfig::recordFLAC ? flacSaveFilterItem : audioSaveFilterItem) };
 
                     if (!result.empty())
-                        gb.apu.startRecording(result);
+                    {
+                        mainThreadLock lock;
+                        gb.apu.startRecording(result, format);
+                    }
 #endif
                 }
+
+                ImGui::SameLine();
+
+                if (ImGui::Checkbox("FLAC", &appConfig::recordFLAC))
+                    appConfig::updateConfigFile();
             }
             ImGui::EndMenu();
         }
         if (ImGui::BeginMenu("Emulation"))
         {
-            if (gb.executingProgram())
+            if (coreState.executingProgram)
             {
                 ImGui::SeparatorText(gbFpsText.c_str());
 
@@ -1514,29 +1778,56 @@ void renderImGUI()
                 const std::string resetKeyStr { formatKeyBind(MegaBoyKey::Reset) };
                 const std::string screenshotKeyStr { formatKeyBind(MegaBoyKey::Screenshot) };
 
-                if (ImGui::MenuItem(gb.emulationPaused ? "Resume" : "Pause", pauseKeyStr.c_str()))
+                if (ImGui::MenuItem(coreState.emulationPaused ? "Resume" : "Pause", pauseKeyStr.c_str()))
+                {
+                    mainThreadLock lock;
                     setEmulationPaused(!gb.emulationPaused);
+                }
+
+#ifndef EMSCRIPTEN
+                if (ImGui::Checkbox("Uncapped Fast Forward", &appConfig::turboFastForward))
+                {
+                    appConfig::updateConfigFile();
 
-                if (gb.cartridge.hasBattery)
+                    if (fastForwarding)
+                    {
+                        mainThreadLock lock;
+                        setFastForwarding(true);
+                    }
+                }
+#endif
+
+                std::optional<bool> resetFull{};
+
+                if (coreState.hasBattery)
                 {
                     if (ImGui::MenuItem("Reset to Battery", resetKeyStr.c_str()))
-                        resetRom(false);
+                        resetFull = false;
 
                     if (ImGui::MenuItem("Full Reset", "Warning!"))
-                        resetRom(true);
+                        resetFull = true;
                 }
                 else
                 {
                     if (ImGui::MenuItem("Reset", resetKeyStr.c_str()))
-                        resetRom(true);
+                        resetFull = true;
+                }
+
+                if (resetFull.has_value())
+                {
+                    mainThreadLock lock;
+                    resetRom(*resetFull);
                 }
 
-                if (gb.cartridge.loaded())
+                if (coreState.cartridgeLoaded)
                 {
                     if (ImGui::MenuItem("Unload Cartridge"))
                     {
-                        gb.unloadCartridge();
-                        handleCartridgeUnload();
+                        {
+                            mainThreadLock lock;
+                            gb.unloadCartridge();
+                            handleCartridgeUnload();
+                        }
 
                         appConfig::romPath.clear();
                         appConfig::updateConfigFile();
@@ -1544,20 +1835,171 @@ void renderImGUI()
                 }
 
                 if (ImGui::MenuItem("Take Screenshot", screenshotKeyStr.c_str()))
+                {
+                    mainThreadLock lock;
                     takeScreenshot(true);
+                }
 
                 if (ImGui::MenuItem("Take 160x144 Screenshot"))
+                {
+                    mainThreadLock lock;
                     takeScreenshot(false);
+                }
+
+                if (coreState.avRecording)
+                {
+                    const auto recordedSeconds { static_cast<int>(coreState.avRecordedSeconds) };
+                    const std::string stopLabel { "Stop Video Recording (" + std::to_string(recordedSeconds / 60) + ":" + (recordedSeconds % 60 < 10 ? "0" : "") + std::to_string(recordedSeconds % 60) + ")" };
+
+                    if (ImGui::MenuItem(stopLabel.c_str()))
+                    {
+                        {
+                            mainThreadLock lock;
+                            gb.stopAVRecording();
+                        }
+#ifdef EMSCRIPTEN
+                        downloadFile("recording.avi", "MegaBoy - Recording.avi");
+                        std::error_code err;
+                        std::filesystem::remove("recording.avi", err);
+#endif
+                    }
+                }
+                else if (ImGui::MenuItem("Start Video Recording"))
+                {
+#ifdef EMSCRIPTEN
+                    mainThreadLock lock;
+                    gb.startAVRecording("recording.avi");
+#else
+                    const auto result { saveFileDialog("MegaBoy - Recording", videoSaveFilterItem) };
+
+                    if (!result.empty())
+                    {
+                        mainThreadLock lock;
+                        gb.startAVRecording(result);
+                    }
+#endif
+                }
+
+                if (coreState.cpuTracing)
+                {
+                    const std::string stopLabel { "Stop CPU Trace (" + std::to_string(coreState.cpuTraceInstructions) + " Instructions)" };
+
+                    if (ImGui::MenuItem(stopLabel.c_str()))
+                    {
+                        {
+                            mainThreadLock lock;
+                            gb.stopCPUTrace();
+                        }
+#ifdef EMSCRIPTEN
+                        downloadFile("trace.mbt", (coreState.gameTitle + " - Trace.mbt").c_str());
+                        std::error_code err;
+                        std::filesystem::remove("trace.mbt", err);
+#endif
+                    }
+                }
+                else if (ImGui::MenuItem("Start CPU Trace"))
+                {
+#ifdef EMSCRIPTEN
+                    mainThreadLock lock;
+                    gb.startCPUTrace("trace.mbt");
+#else
+                    const auto result { saveFileDialog(coreState.gameTitle + " - Trace", cpuTraceFilterItem) };
+
+                    if (!result.empty())
+                    {
+                        mainThreadLock lock;
+                        gb.startCPUTrace(result);
+                    }
+#endif
+                }
+
+                if (coreState.movieRecording)
+                {
+                    const std::string stopLabel { "Stop Movie Recording (Frame " + std::to_string(coreState.movieFrame) + ")" };
+
+                    if (ImGui::MenuItem(stopLabel.c_str()))
+                    {
+                        {
+                            mainThreadLock lock;
+                            gb.stopMovie();
+                        }
+#ifdef EMSCRIPTEN
+                        downloadFile("movie.mbm", (coreState.gameTitle + " - Movie.mbm").c_str());
+                        std::error_code err;
+                        std::filesystem::remove("movie.mbm", err);
+#endif
+                    }
+                }
+                else if (coreState.movieLoaded)
+                {
+                    int movieFrame { static_cast<int>(coreState.movieFrame) };
+                    ImGui::SetNextItemWidth(ImGui::GetFontSize() * 12);
+
+                    if (ImGui::SliderInt("##movieSeek", &movieFrame, 0, static_cast<int>(coreState.movieLength), coreState.moviePlaying ? "Frame %d" : "Movie Ended"))
+                    {
+                        mainThreadLock lock;
+                        gb.seekMovie(static_cast<uint32_t>(movieFrame));
+                    }
+
+                    if (ImGui::MenuItem("Stop Movie Playback"))
+                    {
+                        mainThreadLock lock;
+                        gb.stopMovie();
+                    }
+                }
+                else if (coreState.cartridgeLoaded && ImGui::BeginMenu("Record Input Movie"))
+                {
+                    std::optional<MovieStart> movieStart{};
+
+                    if (ImGui::MenuItem("From Power-On"))
+                        movieStart = MovieStart::PowerOn;
+
+                    if (ImGui::MenuItem("From Current State", nullptr, false, coreState.canSaveState))
+                        movieStart = MovieStart::SaveState;
+
+                    if (movieStart)
+                    {
+#ifdef EMSCRIPTEN
+                        mainThreadLock lock;
+                        gb.startMovieRecording("movie.mbm", *movieStart);
+#else
+                        const auto result { saveFileDialog(coreState.gameTitle + " - Movie", movieFilterItem) };
+
+                        if (!result.empty())
+                        {
+                            mainThreadLock lock;
+                            gb.startMovieRecording(result, *movieStart);
+                        }
+#endif
+                    }
+
+                    ImGui::EndMenu();
+                }
+
+                if (!coreState.movieRecording && !coreState.movieLoaded && ImGui::MenuItem("Play Input Movie"))
+                {
+#ifdef EMSCRIPTEN
+                    openFileDialog(".mbm");
+#else
+                    const auto result { openFileDialog(movieFilterItem) };
+
+                    if (!result.empty())
+                    {
+                        mainThreadLock lock;
+                        loadFile(result);
+                    }
+#endif
+                }
 
                 if (ImGui::MenuItem("Enter Cheat"))
                     cheatsWindowOpen = true;
             }
 
-            if (!gb.cartridge.loaded())
+            if (!coreState.cartridgeLoaded)
             {
                 ImGui::SeparatorText("No Cartridge!");
 
-                if (!gb.executingBootROM())
+                if (!coreState.executingBootROM)
                 {
                     std::optional<GBSystem> bootRomSys{};
 
@@ -1576,6 +2018,7 @@ void renderImGUI()
 
                     if (bootRomSys.has_value())
                     {
+                        mainThreadLock lock;
                         gb.runNoCartridgeBootROM(*bootRomSys);
                         updateColorCorrection();
                     }
@@ -1584,6 +2027,7 @@ void renderImGUI()
                 {
                     if (ImGui::MenuItem("Shut Down"))
                     {
+                        mainThreadLock lock;
                         gb.shutDown();
                         handleCartridgeUnload();
                     }
@@ -1593,16 +2037,20 @@ void renderImGUI()
             ImGui::EndMenu();
         }
 
-        debugUI::renderMenu();
+        {
+            // Debug menu and windows read and change the core directly.
+            mainThreadLock lock;
+            debugUI::renderMenu();
+        }
 
-        if (gb.executingProgram())
+        if (coreState.executingProgram)
         {
-            if (gb.breakpointHit)
+            if (coreState.breakpointHit)
             {
                 ImGui::Separator();
                 ImGui::Text("Breakpoint Hit!");
             }
-            else if (gb.emulationPaused)
+            else if (coreState.emulationPaused)
             {
                 ImGui::Separator();
                 ImGui::Text("Emulation Paused");
@@ -1610,11 +2058,11 @@ void renderImGUI()
             else if (fastForwarding)
             {
                 ImGui::Separator();
-                ImGui::Text("Fast Forward...");
+                ImGui::Text("Fast Forward (%.1fx)", achievedSpeed);
             }
-            else if (gb.cartridge.loaded() && gb.getSaveNum() != 0)
+            else if (coreState.cartridgeLoaded && coreState.saveNum != 0)
             {
-                const std::string saveText { "Save: " + std::to_string(gb.getSaveNum()) };
+                const std::string saveText { "Save: " + std::to_string(coreState.saveNum) };
                 ImGui::Separator();
                 ImGui::Text("%s", saveText.c_str());
             }
@@ -1661,9 +2109,16 @@ void renderImGUI()
         renderSaveStatesGUI();
 
     if (cheatsWindowOpen)
+    {
+        // Cheats are applied by the emulation thread on every VBlank.
+        mainThreadLock lock;
         renderCheatsGUI();
+    }
 
-    debugUI::renderWindows(scaleFactor);
+    {
+        mainThreadLock lock;
+        debugUI::renderWindows(scaleFactor);
+    }
 
 #ifdef EMSCRIPTEN
     emscriptenUpdateImGuiCursor();
@@ -1686,6 +2141,7 @@ void renderGameBoy(double deltaTime)
 
         if (fadeAmount >= 0.95f)
         {
+            mainThreadLock lock;
             resetFade();
             resetRom(false);
         }
@@ -1693,7 +2149,7 @@ void renderGameBoy(double deltaTime)
             currentShader->setFloat("fadeAmount", fadeAmount);
     }
 
-    if (appConfig::blending && gb.executingProgram())
+    if (appConfig::blending && coreState.executingProgram)
     {
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
         currentShader->setFloat("alpha", 0.5f);
@@ -1703,12 +2159,89 @@ void renderGameBoy(double deltaTime)
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
 }
 
+#ifndef EMSCRIPTEN
+// Called after each vsynced buffer swap.
+void trackDisplayRefresh()
+{
+    // Off by less than this, the display rate is used and dynamic audio rate control absorbs the difference.
+    constexpr double MAX_REFRESH_DEVIATION = 0.0075;
+    constexpr double REFRESH_TRACKING_RATE = 0.02;
+
+    static double lastSwapTime { 0.0 };
+
+    const double currentTime { glfwGetTime() };
+    const double interval { currentTime - lastSwapTime };
+    lastSwapTime = currentTime;
+
+    // Skips swaps that missed a refresh, or returned early.
+    if (interval > displayRefreshPeriod * 0.75 && interval < displayRefreshPeriod * 1.25)
+        displayRefreshPeriod += (interval - displayRefreshPeriod) * REFRESH_TRACKING_RATE;
+
+    if (!appConfig::syncToRefreshRate)
+    {
+        emulationFramePeriod = GBCore::FRAME_RATE;
+        return;
+    }
+
+    // High refresh rate displays show each frame for several refreshes.
+    const double refreshesPerFrame { std::max(std::round(GBCore::FRAME_RATE / displayRefreshPeriod), 1.0) };
+    const double syncedPeriod { displayRefreshPeriod * refreshesPerFrame };
+
+    emulationFramePeriod = std::abs(syncedPeriod / GBCore::FRAME_RATE - 1.0) <= MAX_REFRESH_DEVIATION ? syncedPeriod : GBCore::FRAME_RATE;
+}
+#endif
+
+// Called with emulationMutex held.
+void updateCoreUIState()
+{
+    coreState.executingProgram = gb.executingProgram();
+    coreState.executingBootROM = gb.executingBootROM();
+    coreState.cartridgeLoaded = gb.cartridge.loaded();
+    coreState.hasBattery = gb.cartridge.hasBattery;
+    coreState.canSaveState = gb.canSaveStateNow();
+    coreState.emulationPaused = gb.emulationPaused;
+    coreState.breakpointHit = gb.breakpointHit;
+    coreState.saveNum = gb.getSaveNum();
+    coreState.gameTitle = gb.gameTitle;
+    coreState.system = System::Current();
+
+    coreState.audioRecording = gb.apu.isRecording;
+    coreState.audioRecordedSeconds = gb.apu.getRecordedSeconds();
+    coreState.avRecording = gb.isAVRecording();
+    coreState.avRecordedSeconds = gb.getAVRecordedSeconds();
+    coreState.cpuTracing = gb.isCPUTracing();
+    coreState.cpuTraceInstructions = gb.getCPUTraceInstructions();
+
+    coreState.movieRecording = gb.isMovieRecording();
+    coreState.movieLoaded = gb.movieLoaded();
+    coreState.moviePlaying = gb.isMoviePlaying();
+    coreState.movieFrame = gb.getMovieFrame();
+    coreState.movieLength = gb.getMovieLength();
+}
+
 void render(double deltaTime)
 {
+    {
+        // UI and vsync wait run without the lock, so they don't block the emulation thread.
+        mainThreadLock lock;
+
+        uploadPresentedFrame();
+        updateCoreUIState();
+    }
+
     glClear(GL_COLOR_BUFFER_BIT);
     renderGameBoy(deltaTime);
     renderImGUI();
+
     glfwSwapBuffers(window);
+    PROFILE_FRAME_MARK();
+
+#ifndef EMSCRIPTEN
+    if (appConfig::vsync)
+        trackDisplayRefresh();
+    else
+        emulationFramePeriod = GBCore::FRAME_RATE;
+#endif
 
     if (newIntegerScale != -1)
     {
@@ -1717,6 +2250,7 @@ void render(double deltaTime)
     }
     if (glScreenshotRequested)
     {
+        mainThreadLock lock;
         takeScreenshot(true);
         glScreenshotRequested = false;
     }
@@ -1762,6 +2296,16 @@ void key_callback(GLFWwindow* _window, int key, int scancode, int action, int mo
         return;
     }
 
+    // Applied by the emulation thread before its next frame.
+    if (KeyBindManager::isJoypadKey(key))
+    {
+        const keyEvent event { key, action == GLFW_PRESS };
+        keyEvents.push(&event, 1);
+        return;
+    }
+
+    mainThreadLock lock;
+
     if (!gb.executingProgram())
         return;
 
@@ -1823,8 +2367,6 @@ void key_callback(GLFWwindow* _window, int key, int scancode, int action, int mo
 
         return;
     }
-
-    gb.joypad.update(key, action == GLFW_PRESS);
 }
 
 void drop_callback(GLFWwindow* _window, int count, const char** paths)
@@ -1832,7 +2374,10 @@ void drop_callback(GLFWwindow* _window, int count, const char** paths)
     (void)_window;
 
     if (count > 0)
+    {
+        mainThreadLock lock;
         loadFile(FileUtils::nativePathFromUTF8(paths[0]));
+    }
 }
 
 #ifdef EMSCRIPTEN
@@ -2018,6 +2563,9 @@ void setWindowSize()
 #else
     const GLFWvidmode* mode { glfwGetVideoMode(glfwGetPrimaryMonitor()) };
 
+    if (mode->refreshRate > 0)
+        displayRefreshPeriod = 1.0 / mode->refreshRate;
+
     const int maxViewportHeight { static_cast<int>(mode->height * 0.70f) };
     const int scaleFactor { std::min(maxViewportHeight / PPU::SCR_HEIGHT, mode->width / PPU::SCR_WIDTH) };
 
@@ -2074,23 +2622,132 @@ void setImGUI()
 #endif
 }
 
+// Called with emulationMutex held.
+void runEmulationFrame()
+{
+    keyEvent event;
+
+    while (keyEvents.pop(&event, 1))
+    {
+        if (gb.executingProgram())
+            gb.updateInput(event.key, event.pressed);
+    }
+
+    if (!emulationRunning())
+        return;
+
+    const auto execStart { glfwGetTime() };
+    gb.emulateFrame();
+
+    gbExecuteTimes += (glfwGetTime() - execStart);
+    gbFrameCount++;
+}
+
+#ifndef EMSCRIPTEN
+// Called with emulationMutex held. Runs frames back to back for a few milliseconds, so the lock is released regularly.
+void runTurboSlice()
+{
+    constexpr double SLICE_DURATION = 0.004;
+    constexpr double SPEED_UPDATE_INTERVAL = 0.25;
+
+    static double measureStart { 0.0 };
+    static int measuredFrames { 0 };
+
+    const double sliceStart { glfwGetTime() };
+
+    if (sliceStart - measureStart > SPEED_UPDATE_INTERVAL * 2) // Turbo was just enabled.
+    {
+        measureStart = sliceStart;
+        measuredFrames = 0;
+    }
+
+    do
+    {
+        runEmulationFrame();
+        measuredFrames++;
+    }
+    while (glfwGetTime() - sliceStart < SLICE_DURATION && mainThreadLockRequests == 0);
+
+    const double currentTime { glfwGetTime() };
+
+    if (currentTime - measureStart >= SPEED_UPDATE_INTERVAL)
+    {
+        const int speed { std::max(static_cast<int>(std::lround(measuredFrames * GBCore::FRAME_RATE / (currentTime - measureStart))), 1) };
+
+        // Audio and RTC follow the measured speed, and only about one frame per refresh is rendered.
+        gb.setTurboSpeed(speed);
+        gb.setFrameSkip(speed);
+
+        measureStart = currentTime;
+        measuredFrames = 0;
+    }
+}
+
+void emulationThreadLoop()
+{
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+
+    bool turbo { false };
+
+    while (!exitEmulationThread)
+    {
+        if (windowIconified)
+        {
+            windowIconified.wait(true);
+            continue;
+        }
+
+        if (!turbo)
+        {
+            emulationPacer.setPeriod(emulationFramePeriod);
+            emulationPacer.waitForNextFrame();
+        }
+
+        {
+            std::lock_guard lock { emulationMutex };
+            turbo = turboMode && emulationRunning();
+
+            if (turbo)
+                runTurboSlice();
+            else
+                runEmulationFrame();
+        }
+
+        while (mainThreadLockRequests > 0)
+            std::this_thread::yield();
+    }
+
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+#endif
+
 void mainLoop()
 {
     constexpr double MAX_DELTA_TIME = 0.1;
 
     static double lastFrameTime { glfwGetTime() }, lastRenderTime { lastFrameTime };
     static double gbTimer { 0.0 }, secondsTimer { 0.0 };
-    static double gbExecuteTimes { 0.0 }, frameTimes { 0.0 };
-    static int frameCount { 0 }, gbFrameCount { 0 };
+    static double frameTimes { 0.0 };
+    static int frameCount { 0 };
 
     const double currentTime { glfwGetTime() };
     
 #ifndef EMSCRIPTEN
     if (glfwGetWindowAttrib(window, GLFW_ICONIFIED))
     {
+        windowIconified = true;
         glfwWaitEvents();
         lastFrameTime = currentTime;
     }
+    else if (windowIconified)
+    {
+        windowIconified = false;
+        windowIconified.notify_one();
+    }
 #endif
 
     const double deltaTime { std::clamp(currentTime - lastFrameTime, 0.0, MAX_DELTA_TIME) };
@@ -2105,38 +2762,11 @@ void mainLoop()
         fastForwardChangeFlag = false;
     }
 
+#ifdef EMSCRIPTEN
     const bool shouldRender { appConfig::vsync || gbTimer >= GBCore::FRAME_RATE };
 
     if (shouldRender)
         glfwPollEvents();
-    else
-    {
-#ifndef EMSCRIPTEN
-        if (!appConfig::vsync)
-        {
-            const double remainder { GBCore::FRAME_RATE - gbTimer };
-
-            constexpr double SLEEP_THRESHOLD = 
-#ifdef _WIN32
-                0.002; 
-#else
-                0.001;
-#endif
-            if (remainder >= SLEEP_THRESHOLD) 
-            {
-                // Sleep on windows is less precise than linux/macos, even with timeBeginPeriod(1). So need to sleep less time.
-                const std::chrono::duration<double> sleepTime {
-#ifdef _WIN32
-                    remainder <= 0.004 ? 0.001 : remainder <= 0.006 ? 0.002 : remainder / 1.6
-#else
-                    remainder / 1.5
-#endif
-                };
-                std::this_thread::sleep_for(sleepTime);
-            }
-        }
-#endif
-    }
 
     constexpr int MAX_UPDATES = 2;
     int numUpdates { 0 };
@@ -2144,19 +2774,24 @@ void mainLoop()
     while (gbTimer >= GBCore::FRAME_RATE && numUpdates < MAX_UPDATES)
     {
         if (emulationRunning())
-		{
-            const auto execStart { glfwGetTime() };
-            APU::lastMainThreadTime = execStart;
-            
-            gb.emulateFrame();
-            
-            gbExecuteTimes += (glfwGetTime() - execStart);
-            gbFrameCount++;
+        {
+            runEmulationFrame();
             numUpdates++;
-		}
-        
+        }
+
         gbTimer -= GBCore::FRAME_RATE;
     }
+#else
+    // Emulation runs on its own thread, without vsync the pacer stands in for the swap interval.
+    if (!appConfig::vsync)
+    {
+        renderPacer.setPeriod(GBCore::FRAME_RATE);
+        renderPacer.waitForNextFrame();
+    }
+
+    glfwPollEvents();
+    constexpr bool shouldRender { true };
+#endif
 
     if (shouldRender)
     {
@@ -2171,6 +2806,7 @@ void mainLoop()
 
     if (secondsTimer >= 1.0)
     {
+        mainThreadLock lock;
         std::ostringstream oss;
 
         const double avgFrameTime { (frameTimes / frameCount) * 1000 };
@@ -2182,6 +2818,12 @@ void mainLoop()
         oss << "Core time: " << std::fixed << std::setprecision(2) << avgGBExecuteTime << " ms";
         gbFpsText = oss.str();
 
+        achievedSpeed = gbFrameCount * GBCore::FRAME_RATE * (fastForwarding && !turboActive() ? FAST_FORWARD_SPEED : 1) / secondsTimer;
+
+#ifndef EMSCRIPTEN
+        debugUI::updateFramePacing(emulationPacer.takeJitterStats());
+#endif
+
         if (emulationRunning())
         {
             gb.autoSave();
@@ -2209,6 +2851,10 @@ void runApp(int argc, char* argv[])
     gb.setDrawCallback(drawCallback);
     gb.setBootRomExitCallback(bootRomExitCallback);
 
+    gb.apu.setSampleRate(static_cast<uint32_t>(appConfig::audioSampleRate));
+    gb.apu.setResamplerQuality(static_cast<ResamplerQuality>(appConfig::audioResampler));
+    gb.apu.setTargetLatency(appConfig::audioLatency);
+
     setGLFW();
     setOpenGL();
     setImGUI();
@@ -2237,12 +2883,50 @@ void runApp(int argc, char* argv[])
         }
     }
 
+    emulationThread = std::thread { emulationThreadLoop };
+
     while (!glfwWindowShouldClose(window)) { mainLoop(); }
+
+    exitEmulationThread = true;
+    windowIconified = false;
+    windowIconified.notify_one();
+    emulationThread.join();
 #else
     emscripten_set_main_loop(mainLoop, appConfig::vsync ? 0 : 60, false);
 #endif
 }
 
+#ifndef EMSCRIPTEN
+// MegaBoy --benchmark <workload directory> [report file]. Runs without a window, so it also serves as the PGO training run.
+int runBenchmark(int argc, char* argv[])
+{
+#ifdef _WIN32
+    const auto args { CommandLineToArgvW(GetCommandLineW(), &argc) };
+
+    if (args == nullptr)
+        return 1;
+#else
+    char** args { argv };
+#endif
+    // The config file isn't loaded, so results don't depend on user settings. Battery saves are not written next to the workload ROMs.
+    appConfig::runBootROM = false;
+    appConfig::batterySaves = false;
+
+    std::ofstream reportFile;
+
+    if (argc > 3)
+        reportFile.open(std::filesystem::path { args[3] });
+
+    std::ostream& report { argc > 3 ? reportFile : std::cout };
+    const bool success { Benchmark::run(gb, args[2], report) };
+
+#ifdef _WIN32
+    LocalFree(args);
+#endif
+    return success ? 0 : 1;
+}
+#endif
+
 int main(int argc, char* argv[])
 {
 #ifdef EMSCRIPTEN
@@ -2257,6 +2941,9 @@ int main(int argc, char* argv[])
         });
     });
 #else
+    if (argc > 2 && std::string_view { argv[1] } == "--benchmark")
+        return runBenchmark(argc, argv);
+
     runApp(argc, argv);
     gb.autoSave();
 
@@ -4,7 +4,9 @@
 #include <array>
 #include <iostream>
 #include <memory>
+#include <algorithm>
 #include <functional>
+#include <utility>
 #include <random>
 
 #include "../gbSystem.h"
@@ -12,6 +14,7 @@
 #include "../Utils/pixelOps.h"
 #include "../Utils/bitOps.h"
 #include "../Utils/rngOps.h"
+#include "../Utils/memoryPages.h"
 
 using color = PixelOps::color;
 
@@ -120,6 +123,34 @@ protected:
 	uint8_t size{ 0 };
 };
 
+// Part of a debug view redrawn by the last render call.
+struct debugViewRect
+{
+	int x{};
+	int y{};
+	int width{};
+	int height{};
+
+	inline bool empty() const { return width == 0; }
+
+	inline void addTile(int tileX, int tileY)
+	{
+		if (empty())
+		{
+			*this = debugViewRect { tileX, tileY, 8, 8 };
+			return;
+		}
+
+		const int right { std::max(x + width, tileX + 8) };
+		const int bottom { std::max(y + height, tileY + 8) };
+
+		x = std::min(x, tileX);
+		y = std::min(y, tileY);
+		width = right - x;
+		height = bottom - y;
+	}
+};
+
 struct BGPixelFIFO : PixelFIFO<BGFIFOState>
 { };
 
@@ -265,6 +296,7 @@ class PPU
 {
 	friend class debugUI;
 	friend class MMU;
+	friend class GBCore;
 
 public:
 	static constexpr uint8_t SCR_WIDTH = 160;
@@ -287,24 +319,30 @@ public:
 	static constexpr std::array DEFAULT_CUSTOM_PALETTE { color {196, 240, 194}, color {90, 185, 168}, color {30, 96, 110}, color {45, 27, 0} };
 	static inline std::array CUSTOM_PALETTE { DEFAULT_CUSTOM_PALETTE };
 
-	static inline const color* ColorPalette { };
+	static inline const color* ColorPalette { GRAY_PALETTE.data() };
 
 	virtual ~PPU() = default;
 
-	std::function<void(const uint8_t*, bool)> drawCallback { nullptr };
+	std::function<void(const uint8_t*, bool, bool)> drawCallback { nullptr };
 
 	virtual void execute() = 0;
-	virtual void reset(bool clearBuf) = 0;
+	// VRAM keeps its contents if clearVRAM is false.
+	virtual void reset(bool clearBuf, bool clearVRAM) = 0;
 
 	virtual void setLCDEnable(bool val) = 0;
 
 	virtual void saveState(std::ostream& st) const = 0;
 	virtual void loadState(std::istream& st) = 0;
 
+	// Same as above without VRAM, which state forks store in pages.
+	virtual void saveForkState(std::ostream& st) const = 0;
+	virtual void loadForkState(std::istream& st) = 0;
+
 	virtual void refreshDMGScreenColors(const std::array<color, 4>& newColorPalette) = 0;
 
-	virtual void renderTileData(uint8_t* buffer, int vramBank) = 0;
-	virtual void renderTileMap(uint8_t* buffer, uint16_t addr) = 0;
+	// Only tiles changed since the last call are redrawn, unless redrawAll is set (e.g. palette has changed).
+	virtual debugViewRect renderTileData(uint8_t* buffer, int vramBank, bool redrawAll) = 0;
+	virtual debugViewRect renderTileMap(uint8_t* buffer, uint16_t addr, bool redrawAll) = 0;
 
 	inline uint8_t* framebufferPtr() { return framebuffer.get(); }
 	inline uint8_t* backbufferPtr() { return backbuffer.get(); }
@@ -313,6 +351,13 @@ public:
 	inline uint8_t* bgFramebuffer() { return debugBGFramebuffer.get(); }
 	inline uint8_t* windowFramebuffer() { return debugWindowFramebuffer.get(); }
 
+	// When rendering is disabled, mode timing, STAT interrupts and LY/LYC stay exact, but pixels are not mixed or written to the backbuffer.
+	inline void setRenderEnable(bool val) { renderEnabled = val; }
+	inline bool renderingEnabled() const { return renderEnabled; }
+
+	// True if the object layer of the debug output was redrawn since the last call.
+	inline bool takeOAMViewRedraw() { return std::exchange(oamViewRedrawn, false); }
+
 	inline void setDebugEnable(bool val)
 	{
 		debugPPU = val;
@@ -320,9 +365,15 @@ public:
 		if (val && !debugOAMFramebuffer)
 		{
 			debugOAMFramebuffer = std::make_unique<uint8_t[]>(FRAMEBUFFER_SIZE);
+			debugOAMBackbuffer = std::make_unique<uint8_t[]>(FRAMEBUFFER_SIZE);
 			debugBGFramebuffer = std::make_unique<uint8_t[]>(FRAMEBUFFER_SIZE);
 			debugWindowFramebuffer = std::make_unique<uint8_t[]>(FRAMEBUFFER_SIZE);
+			PixelOps::clearBuffer(debugOAMFramebuffer.get(), SCR_WIDTH, SCR_HEIGHT, ColorPalette[0]);
 		}
+
+		// Frame in progress may be partially drawn, so the object layer starts with the next one.
+		drawOAMView = false;
+		oamViewDirty = true;
 	}
 protected:
 	std::unique_ptr<uint8_t[]> framebuffer { std::make_unique<uint8_t[]>(FRAMEBUFFER_SIZE) };
@@ -333,6 +384,7 @@ protected:
 	std::array<uint8_t, 8192> VRAM_BANK1{};
 
 	uint8_t* VRAM { VRAM_BANK0.data() };
+	std::array<MemoryPages::dirtyMask, 2> vramDirtyPages { MemoryPages::ALL_DIRTY, MemoryPages::ALL_DIRTY };
 
 	std::array<uint8_t, 4> BGP{};
 	std::array<uint8_t, 4> OBP0{};
@@ -341,6 +393,11 @@ protected:
 	uint8_t objCount{ 0 };
 	std::array<OAMobject, 10> selectedObjects{};
 
+	// OAM addresses of objects selected on each line, sorted by X. Rebuilt only after OAM or OBJ size changes, instead of scanning OAM every line.
+	std::array<std::array<uint8_t, 10>, SCR_HEIGHT> lineObjects{};
+	std::array<uint8_t, SCR_HEIGHT> lineObjCount{};
+	bool lineObjectsDirty { true };
+
 	ppuDMGRegs regs{};
 	ppuGBCRegs gbcRegs{};
 
@@ -348,11 +405,58 @@ protected:
 	BGPixelFIFO bgFIFO{};
 	ObjPixelFIFO objFIFO{};
 
+	bool renderEnabled { true };
+
+	// Tiles and tile map entries up to date in each debug view. Cleared on VRAM writes, so only changed ones get redrawn.
+	static constexpr uint8_t TILE_DATA_VIEW = 1 << 0;
+	static constexpr uint8_t TILE_MAP_9800_VIEW = 1 << 1;
+	static constexpr uint8_t TILE_MAP_9C00_VIEW = 1 << 2;
+
+	std::array<uint8_t, 384 * 2> tileViewValid{};
+	std::array<bool, 0x800> tileMapViewValid{};
+
+	inline void invalidateDebugViews()
+	{
+		tileViewValid.fill(0);
+		tileMapViewValid.fill(false);
+		oamViewDirty = true;
+	}
+
 	bool debugPPU { false };
 	std::unique_ptr<uint8_t[]> debugOAMFramebuffer{};
+	std::unique_ptr<uint8_t[]> debugOAMBackbuffer{};
 	std::unique_ptr<uint8_t[]> debugBGFramebuffer{};
 	std::unique_ptr<uint8_t[]> debugWindowFramebuffer{};
 
+	// Object layer only changes with OAM, object tiles, object palettes or LCDC, or together with the screen (BG priority).
+	// It's drawn only in frames following such a change, otherwise the last drawn layer is kept.
+	bool oamViewDirty { true };
+	bool drawOAMView { false };
+	bool oamViewRedrawn { false };
+
+	// Called when a rendered frame starts, so OAM DMA during VBlank is picked up by the next frame.
+	inline void startOAMView()
+	{
+		drawOAMView = oamViewDirty;
+		oamViewDirty = false;
+
+		if (drawOAMView)
+			PixelOps::clearBuffer(debugOAMBackbuffer.get(), SCR_WIDTH, SCR_HEIGHT, ColorPalette[0]);
+	}
+
+	// Called on VBlank of rendered frames.
+	inline void presentOAMView(bool screenChanged)
+	{
+		oamViewDirty |= screenChanged;
+
+		if (!drawOAMView)
+			return;
+
+		std::swap(debugOAMFramebuffer, debugOAMBackbuffer);
+		oamViewRedrawn = true;
+		drawOAMView = false;
+	}
+
 	inline uint8_t readSTAT()
 	{
 		// Mode change is 1M cycle delayed.
@@ -365,6 +469,47 @@ protected:
 			palette[i] = (getBit(val, i * 2 + 1) << 1) | getBit(val, i * 2);
 	}
 
+	inline void writeOAM(uint8_t addr, uint8_t val)
+	{
+		if (OAM[addr] == val)
+			return;
+
+		OAM[addr] = val;
+		oamViewDirty = true;
+
+		// Only Y and X bytes affect which objects are selected on each line.
+		if ((addr & 0x3) < 2)
+			lineObjectsDirty = true;
+	}
+	inline void writeVRAM(uint16_t addr, uint8_t val)
+	{
+		if (VRAM[addr] == val)
+			return;
+
+		VRAM[addr] = val;
+
+		const bool bank1 { VRAM == VRAM_BANK1.data() };
+		vramDirtyPages[bank1] |= MemoryPages::pageBit(addr);
+
+		if (addr < 0x1800)
+		{
+			tileViewValid[(bank1 ? 384 : 0) + addr / 16] = 0;
+
+			// Objects always use tiles at 0x8000-0x8FFF.
+			oamViewDirty |= addr < 0x1000;
+		}
+		else // Bank 1 holds attributes of the same tile map entry on CGB.
+			tileMapViewValid[addr - 0x1800] = false;
+	}
+	inline void writeLCDC(uint8_t val)
+	{
+		if (getBit(regs.LCDC ^ val, 2))
+			lineObjectsDirty = true;
+
+		oamViewDirty |= regs.LCDC != val;
+		regs.LCDC = val;
+	}
+
 	inline void setVRAMBank(uint8_t val)
 	{
 		VRAM = val & 0x1 ? VRAM_BANK1.data() : VRAM_BANK0.data();
@@ -11,18 +11,30 @@ template class PPUCore<GBSystem::CGB>;
 template class PPUCore<GBSystem::DMGCompatMode>;
 
 template <GBSystem sys>
-void PPUCore<sys>::reset(bool clearBuf)
+void PPUCore<sys>::reset(bool clearBuf, bool clearVRAM)
 {
 	std::memset(OAM.data(), 0, sizeof(OAM));
-	std::memset(VRAM_BANK0.data(), 0, sizeof(VRAM_BANK0));
+	lineObjectsDirty = true;
+	invalidateDebugViews();
 	VRAM = VRAM_BANK0.data();
 
+	if (clearVRAM)
+	{
+		std::memset(VRAM_BANK0.data(), 0, sizeof(VRAM_BANK0));
+		vramDirtyPages[0] = MemoryPages::ALL_DIRTY;
+	}
+
 	s = {};
 	regs = {};
 
 	if constexpr (System::IsCGBDevice(sys))
 	{
-		std::memset(VRAM_BANK1.data(), 0, sizeof(VRAM_BANK1));
+		if (clearVRAM)
+		{
+			std::memset(VRAM_BANK1.data(), 0, sizeof(VRAM_BANK1));
+			vramDirtyPages[1] = MemoryPages::ALL_DIRTY;
+		}
+
 		gbcRegs.reset();
 	}
 	if constexpr (sys != GBSystem::CGB)
@@ -36,7 +48,18 @@ void PPUCore<sys>::reset(bool clearBuf)
 }
 
 template <GBSystem s>
-void PPUCore<s>::saveState(std::ostream& st) const
+void PPUCore<s>::saveState(std::ostream& st) const { save<true>(st); }
+template <GBSystem s>
+void PPUCore<s>::loadState(std::istream& st) { load<true>(st); }
+
+template <GBSystem s>
+void PPUCore<s>::saveForkState(std::ostream& st) const { save<false>(st); }
+template <GBSystem s>
+void PPUCore<s>::loadForkState(std::istream& st) { load<false>(st); }
+
+template <GBSystem s>
+template <bool withVRAM>
+void PPUCore<s>::save(std::ostream& st) const
 {
 	ST_WRITE(regs);
 	ST_WRITE(s);
@@ -51,11 +74,13 @@ void PPUCore<s>::saveState(std::ostream& st) const
 	{
 		gbcRegs.saveState(st);
 
-		if (sys == GBSystem::CGB)
+		if (withVRAM && sys == GBSystem::CGB)
 			ST_WRITE_ARR(VRAM_BANK1);
 	}
 
-	ST_WRITE_ARR(VRAM_BANK0);
+	if constexpr (withVRAM)
+		ST_WRITE_ARR(VRAM_BANK0);
+
 	ST_WRITE_ARR(OAM);
 
 	if (s.state == PPUMode::PixelTransfer)
@@ -71,7 +96,8 @@ void PPUCore<s>::saveState(std::ostream& st) const
 }
 
 template <GBSystem s>
-void PPUCore<s>::loadState(std::istream& st)
+template <bool withVRAM>
+void PPUCore<s>::load(std::istream& st)
 {
 	ST_READ(regs);
 	ST_READ(s);
@@ -82,7 +108,7 @@ void PPUCore<s>::loadState(std::istream& st)
 	{
 		gbcRegs.loadState(st);
 
-		if (sys == GBSystem::CGB)
+		if (withVRAM && sys == GBSystem::CGB)
 			ST_READ_ARR(VRAM_BANK1);
 	}
 	if (sys != GBSystem::CGB)
@@ -92,8 +118,15 @@ void PPUCore<s>::loadState(std::istream& st)
 		updatePalette(regs.OBP1, this->OBP1);
 	}
 
-	ST_READ_ARR(VRAM_BANK0);
+	if constexpr (withVRAM)
+	{
+		ST_READ_ARR(VRAM_BANK0);
+		vramDirtyPages.fill(MemoryPages::ALL_DIRTY);
+	}
+
 	ST_READ_ARR(OAM);
+	lineObjectsDirty = true;
+	invalidateDebugViews();
 
 	if (s.state == PPUMode::PixelTransfer)
 	{
@@ -376,10 +409,14 @@ void PPUCore<sys>::handleOAMSearch()
 	if (s.videoCycles >= OAM_SCAN_CYCLES) [[unlikely]]
 	{
 		s.videoCycles -= OAM_SCAN_CYCLES;
-		objCount = 0;
+		if (lineObjectsDirty) [[unlikely]]
+			buildLineObjects();
 
-		for (uint8_t oamAddr = 0; oamAddr < sizeof(OAM) && objCount < 10; oamAddr += 4)
+		objCount = lineObjCount[s.LY];
+
+		for (uint8_t i = 0; i < objCount; i++)
 		{
+			const uint8_t oamAddr { lineObjects[s.LY][i] };
 			const int16_t objY { static_cast<int16_t>(OAM[oamAddr] - 16) };
 			const int16_t objX { static_cast<int16_t>(OAM[oamAddr + 1] - 8) };
 			const uint8_t tileInd { OAM[oamAddr + 2] };
@@ -387,31 +424,58 @@ void PPUCore<sys>::handleOAMSearch()
 			const bool yFlip { static_cast<bool>(getBit(attributes, 6)) };
 
 			if (!DoubleOBJSize())
-			{
-				if (s.LY >= objY && s.LY < objY + 8)
-					selectedObjects[objCount++] = OAMobject{ objX, objY, static_cast<uint16_t>(tileInd * 16), attributes, oamAddr };
-			}
+				selectedObjects[i] = OAMobject{ objX, objY, static_cast<uint16_t>(tileInd * 16), attributes, oamAddr };
 			else
 			{
-				if (s.LY >= objY && s.LY < objY + 8)
+				if (s.LY < objY + 8)
 				{
 					const uint16_t tileAddr = yFlip ? ((tileInd & 0xFE) + 1) * 16 : (tileInd & 0xFE) * 16;
-					selectedObjects[objCount++] = OAMobject{ objX, objY, tileAddr, attributes, oamAddr };
+					selectedObjects[i] = OAMobject{ objX, objY, tileAddr, attributes, oamAddr };
 				}
-				else if (s.LY >= objY + 8 && s.LY < objY + 16)
+				else
 				{
 					const uint16_t tileAddr = yFlip ? (tileInd & 0xFE) * 16 : ((tileInd & 0xFE) + 1) * 16;
-					selectedObjects[objCount++] = OAMobject{ objX, static_cast<int16_t>(objY + 8), tileAddr, attributes, oamAddr };
+					selectedObjects[i] = OAMobject{ objX, static_cast<int16_t>(objY + 8), tileAddr, attributes, oamAddr };
 				}
 			}
 		}
 
-		std::stable_sort(selectedObjects.begin(), selectedObjects.begin() + objCount, [](const auto& a, const auto& b) { return a.X < b.X; });
-
 		SetPPUMode(PPUMode::PixelTransfer);
 	}
 }
 
+template <GBSystem sys>
+void PPUCore<sys>::buildLineObjects()
+{
+	lineObjectsDirty = false;
+	lineObjCount.fill(0);
+
+	const int objHeight { DoubleOBJSize() ? 16 : 8 };
+
+	// Objects are added in OAM order, so each line keeps the first 10 objects like the hardware OAM scan does.
+	for (uint8_t oamAddr = 0; oamAddr < sizeof(OAM); oamAddr += 4)
+	{
+		const int objY { OAM[oamAddr] - 16 };
+		const uint8_t objX { OAM[oamAddr + 1] };
+
+		for (int line = std::max(objY, 0); line < std::min(objY + objHeight, static_cast<int>(SCR_HEIGHT)); line++)
+		{
+			uint8_t& count { lineObjCount[line] };
+			if (count == 10)
+				continue;
+
+			// Insertion by X keeps objects with equal X in OAM order.
+			auto& objects { lineObjects[line] };
+			uint8_t i { count++ };
+
+			for (; i > 0 && OAM[objects[i - 1] + 1] > objX; i--)
+				objects[i] = objects[i - 1];
+
+			objects[i] = oamAddr;
+		}
+	}
+}
+
 template <GBSystem sys>
 void PPUCore<sys>::handleVBlank()
 {
@@ -433,6 +497,9 @@ void PPUCore<sys>::handleVBlank()
 		case 1:
 			s.LY = 0;
 			SetPPUMode(PPUMode::OAMSearch);
+
+			if (debugPPU && renderEnabled)
+				startOAMView();
 			break;
 		default:
 			s.vblankLineCycles = DEFAULT_VBLANK_LINE_CYCLES;
@@ -712,6 +779,14 @@ void PPUCore<sys>::renderFIFOs()
 		return;
 	}
 
+	if (!renderEnabled)
+	{
+		// Pixel still has to be shifted out of both FIFOs, so mode 3 timing stays the same.
+		if (!objFIFO.empty()) objFIFO.pop();
+		s.xPosCounter++;
+		return;
+	}
+
 	if constexpr (sys != GBSystem::CGB)
 		if (!DMGTileMapsEnable()) bg.color = 0;
 
@@ -729,8 +804,8 @@ void PPUCore<sys>::renderFIFOs()
 
 		outputColor = objHasPriority ? getColor<true, true>(obj.color, obj.palette) : getColor<false, true>(bg.color, bg.palette);
 
-		if (debugPPU && objHasPriority)
-			PixelOps::setPixel(debugOAMFramebuffer.get(), SCR_WIDTH, s.xPosCounter, s.LY, getColor<true>(obj.color, obj.palette));
+		if (debugPPU && drawOAMView && objHasPriority)
+			PixelOps::setPixel(debugOAMBackbuffer.get(), SCR_WIDTH, s.xPosCounter, s.LY, getColor<true>(obj.color, obj.palette));
 	}
 	else
 		outputColor = getColor<false, true>(bg.color, bg.palette);
@@ -750,15 +825,24 @@ void PPUCore<sys>::renderFIFOs()
 
 
 template <GBSystem sys>
-void PPUCore<sys>::renderTileData(uint8_t* buffer, int vramBank)
+debugViewRect PPUCore<sys>::renderTileData(uint8_t* buffer, int vramBank, bool redrawAll)
 {
 	const uint8_t* vram { vramBank == 1 ? VRAM_BANK1.data() : VRAM_BANK0.data() };
+	debugViewRect redrawnRect{};
 
 	for (int addr = 0; addr < 0x17FF; addr += 16)
 	{
 		const int tileInd { addr / 16 };
+		uint8_t& validViews { tileViewValid[vramBank * 384 + tileInd] };
+
+		if (!redrawAll && (validViews & TILE_DATA_VIEW))
+			continue;
+
+		validViews |= TILE_DATA_VIEW;
+
 		const int screenX { (tileInd % 16) * 8 };
 		const int screenY { (tileInd / 16) * 8 };
+		redrawnRect.addTile(screenX, screenY);
 
 		for (int y = 0; y < 8; y++)
 		{
@@ -774,11 +858,16 @@ void PPUCore<sys>::renderTileData(uint8_t* buffer, int vramBank)
 			}
 		}
 	}
+
+	return redrawnRect;
 }
 
 template <GBSystem sys>
-void PPUCore<sys>::renderTileMap(uint8_t* buffer, uint16_t addr)
+debugViewRect PPUCore<sys>::renderTileMap(uint8_t* buffer, uint16_t addr, bool redrawAll)
 {
+	const uint8_t viewBit { addr == 0x9800 ? TILE_MAP_9800_VIEW : TILE_MAP_9C00_VIEW };
+	debugViewRect redrawnRect{};
+
 	for (int y = 0; y < 32; y++)
 	{
 		for (int x = 0; x < 32; x++)
@@ -787,6 +876,16 @@ void PPUCore<sys>::renderTileMap(uint8_t* buffer, uint16_t addr)
 			const uint8_t tileMap { VRAM_BANK0[tileMapInd] };
 			const int screenX { x * 8 }, screenY { y * 8 };
 
+			// Entry is redrawn if either itself or the tile it points to has changed.
+			const int tileBank { sys == GBSystem::CGB ? getBit(VRAM_BANK1[tileMapInd], 3) : 0 };
+			const bool tileValid { static_cast<bool>(tileViewValid[tileBank * 384 + getBGTileAddr(tileMap) / 16] & viewBit) };
+
+			if (!redrawAll && tileValid && tileMapViewValid[tileMapInd - 0x1800])
+				continue;
+
+			tileMapViewValid[tileMapInd - 0x1800] = true;
+			redrawnRect.addTile(screenX, screenY);
+
 			if constexpr (sys == GBSystem::CGB)
 			{
 				const uint8_t attributes { VRAM_BANK1[tileMapInd] };
@@ -831,4 +930,10 @@ void PPUCore<sys>::renderTileMap(uint8_t* buffer, uint16_t addr)
 			}
 		}
 	}
+
+	// All entries pointing to changed tiles were redrawn.
+	for (auto& validViews : tileViewValid)
+		validViews |= viewBit;
+
+	return redrawnRect;
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <array>
+#include <cstring>
 #include <vector>
 
 #include "PPU.h"
@@ -14,19 +15,29 @@ public:
 	PPUCore(MMU& mmu, CPU& cpu) : mmu(mmu), cpu(cpu) { }
 
 	void execute() override;
-	void reset(bool clearBuf) override;
+	void reset(bool clearBuf, bool clearVRAM) override;
 
 	void saveState(std::ostream& st) const override;
 	void loadState(std::istream& st) override;
 
+	void saveForkState(std::ostream& st) const override;
+	void loadForkState(std::istream& st) override;
+
 	void refreshDMGScreenColors(const std::array<color, 4>& newColors) override;
 
-	void renderTileMap(uint8_t* buffer, uint16_t addr) override;
-	void renderTileData(uint8_t* buffer, int vramBank) override;
+	debugViewRect renderTileMap(uint8_t* buffer, uint16_t addr, bool redrawAll) override;
+	debugViewRect renderTileData(uint8_t* buffer, int vramBank, bool redrawAll) override;
 private:
 	MMU& mmu;
 	CPU& cpu;
 
+	template <bool withVRAM>
+	void save(std::ostream& st) const;
+	template <bool withVRAM>
+	void load(std::istream& st);
+
+	bool frameChanged { true };
+
 	static constexpr uint16_t TOTAL_SCANLINE_CYCLES = 456;
 	static constexpr uint16_t OAM_SCAN_CYCLES = 20 * 4;
 	static constexpr uint16_t DEFAULT_VBLANK_LINE_CYCLES = 114 * 4;
@@ -34,15 +45,29 @@ private:
 
 	inline void invokeDrawCallback(bool firstFrame = false) 
 	{
-		std::swap(framebuffer, backbuffer);
+		frameChanged = false;
+
+		// Skipped frames don't touch the backbuffer, so the last rendered frame stays in the framebuffer.
+		if (renderEnabled)
+		{
+			// Static screens (menus, text boxes, pauses) are common, so frontend can skip texture uploads, encoding etc. for them.
+			frameChanged = std::memcmp(framebuffer.get(), backbuffer.get(), FRAMEBUFFER_SIZE) != 0;
+			std::swap(framebuffer, backbuffer);
+
+			if (debugPPU)
+				presentOAMView(frameChanged);
+		}
 
 		if (drawCallback != nullptr)
-			drawCallback(framebuffer.get(), firstFrame);
+			drawCallback(framebuffer.get(), firstFrame, frameChanged);
 	}
 
 	inline void clearBuffer(bool firstFrame = false)
 	{
 		PixelOps::clearBuffer(backbuffer.get(), SCR_WIDTH, SCR_HEIGHT, sys == GBSystem::DMG ? PPU::ColorPalette[0] : color { 255, 255, 255 });
+
+		// Blank frame is always presented, even if frame skipping is active (e.g. LCD is disabled and no more frames will come).
+		renderEnabled = true;
 		invokeDrawCallback(firstFrame);
 	}
 
@@ -56,6 +81,7 @@ private:
 	bool canWriteOAM() override;
 
 	void handleOAMSearch();
+	void buildLineObjects();
 	void handleHBlank();
 	void handleVBlank();
 	void handlePixelTransfer();
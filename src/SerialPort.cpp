@@ -1,4 +1,5 @@
 #include "SerialPort.h"
+#include "Utils/profiler.h"
 
 void SerialPort::writeSerialControl(uint8_t val)
 {
@@ -29,6 +30,8 @@ void SerialPort::execute()
     if (!(s.serialControl & 0x1)) // External clock is selected.
         return;
 
+    PROFILE_SCOPE(Serial);
+
     const bool highClockSpeed { System::Current() == GBSystem::CGB && (s.serialControl & 0b10) };
     const int serialTransferCycles { highClockSpeed ? 128 : 4 };
 
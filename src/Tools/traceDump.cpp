@@ -0,0 +1,59 @@
+#include <iostream>
+#include <fstream>
+#include <string_view>
+#include "../CPU/cpuTracer.h"
+
+// Expands a binary CPU trace recorded by MegaBoy into a text log that can be diffed against other emulators.
+int main(int argc, char* argv[])
+{
+	bool extended { false };
+	std::vector<std::string_view> paths;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg { argv[i] };
+
+		if (arg == "--extended")
+			extended = true;
+		else
+			paths.push_back(arg);
+	}
+
+	if (paths.empty() || paths.size() > 2)
+	{
+		std::cerr << "Usage: MegaBoyTraceDump [--extended] <trace.mbt> [output.txt]\n"
+					 "--extended adds IF, IE, LY and the cycle count to every line.\n";
+		return 1;
+	}
+
+	std::ifstream in { std::filesystem::path { paths[0] }, std::ios::binary };
+
+	if (!in)
+	{
+		std::cerr << "Failed to open " << paths[0] << "\n";
+		return 1;
+	}
+
+	std::ofstream file;
+
+	if (paths.size() == 2)
+	{
+		file.open(std::filesystem::path { paths[1] });
+
+		if (!file)
+		{
+			std::cerr << "Failed to create " << paths[1] << "\n";
+			return 1;
+		}
+	}
+
+	std::ostream& out { paths.size() == 2 ? file : std::cout };
+
+	if (!CPUTracer::expandToText(in, out, extended))
+	{
+		std::cerr << "Invalid or truncated trace.\n";
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
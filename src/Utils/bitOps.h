@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <array>
+#include <string>
 
 template<typename T>
 constexpr uint8_t getBit(T val, uint8_t bit) { return static_cast<bool>(val & (1 << bit)); }
@@ -0,0 +1,114 @@
+#include "framePacer.h"
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+#ifdef __linux__
+#include <ctime>
+#include <cerrno>
+#endif
+
+namespace
+{
+	constexpr double MIN_SPIN_US = 50.0;
+	constexpr double MAX_SPIN_US = 4000.0;
+	constexpr double CALIBRATION_RATE = 0.05;
+}
+
+void FramePacer::waitForNextFrame()
+{
+	auto now { clock::now() };
+
+	if (nextFrameTime == clock::time_point{})
+		nextFrameTime = now;
+
+	const auto sleepTarget { nextFrameTime - std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::micro> { spinMargin.load(std::memory_order_relaxed) }) };
+
+	if (now < sleepTarget)
+	{
+		sleepUntil(sleepTarget);
+		now = clock::now();
+		calibrate(std::chrono::duration<double, std::micro> { now - sleepTarget }.count());
+	}
+
+	while (now < nextFrameTime)
+	{
+		std::this_thread::yield();
+		now = clock::now();
+	}
+
+	const auto errorUs { std::chrono::duration_cast<std::chrono::microseconds>(now - nextFrameTime).count() };
+	const auto bucket { std::min(static_cast<size_t>(errorUs / BUCKET_US), BUCKET_COUNT - 1) };
+	errorHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+	nextFrameTime += period;
+
+	if (now - nextFrameTime > MAX_LAG) [[unlikely]]
+		nextFrameTime = now;
+}
+
+void FramePacer::sleepUntil(clock::time_point time)
+{
+#ifdef __linux__
+	// steady_clock is CLOCK_MONOTONIC, an absolute deadline doesn't drift by the time spent setting up the sleep.
+	const auto sinceEpoch { time.time_since_epoch() };
+	const auto seconds { std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch) };
+
+	timespec ts{};
+	ts.tv_sec = static_cast<time_t>(seconds.count());
+	ts.tv_nsec = static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(sinceEpoch - seconds).count());
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+#else
+	std::this_thread::sleep_until(time);
+#endif
+}
+
+void FramePacer::calibrate(double overshootUs)
+{
+	// Exponentially weighted mean and variance, the margin covers nearly all wakeups.
+	const double diff { overshootUs - overshootMean };
+	overshootMean += diff * CALIBRATION_RATE;
+	overshootVar = (1.0 - CALIBRATION_RATE) * (overshootVar + diff * diff * CALIBRATION_RATE);
+
+	spinMargin.store(std::clamp(overshootMean + 3.0 * std::sqrt(overshootVar), MIN_SPIN_US, MAX_SPIN_US), std::memory_order_relaxed);
+}
+
+FramePacer::jitterStats FramePacer::takeJitterStats()
+{
+	std::array<uint32_t, BUCKET_COUNT> counts{};
+	uint32_t total { 0 };
+
+	for (size_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		counts[i] = errorHistogram[i].exchange(0, std::memory_order_relaxed);
+		total += counts[i];
+	}
+
+	jitterStats stats { 0.0, 0.0, 0.0, total };
+
+	if (total == 0)
+		return stats;
+
+	const auto bucketMs = [](size_t bucket) { return static_cast<double>((bucket + 1) * BUCKET_US) / 1000.0; };
+
+	const uint32_t p50Rank { (total + 1) / 2 };
+	const uint32_t p99Rank { total - total / 100 };
+	uint32_t seen { 0 };
+
+	for (size_t i = 0; i < BUCKET_COUNT; i++)
+	{
+		if (counts[i] == 0)
+			continue;
+
+		if (seen < p50Rank && seen + counts[i] >= p50Rank)
+			stats.p50 = bucketMs(i);
+		if (seen < p99Rank && seen + counts[i] >= p99Rank)
+			stats.p99 = bucketMs(i);
+
+		seen += counts[i];
+		stats.max = bucketMs(i);
+	}
+
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <chrono>
+
+// Waits for evenly spaced frame starts: sleeps until shortly before the deadline, then spins the rest.
+// The spin margin is calibrated from how late sleeps actually wake up, so it stays small on precise timers.
+class FramePacer
+{
+public:
+	using clock = std::chrono::steady_clock;
+
+	struct jitterStats
+	{
+		double p50, p99, max; // Milliseconds late.
+		uint32_t frames;
+	};
+
+	inline void setPeriod(double seconds) { period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double> { seconds }); }
+
+	// Blocks until the next frame start and schedules the one after it.
+	void waitForNextFrame();
+
+	// Frame start error since the last call, can be called from any thread.
+	jitterStats takeJitterStats();
+
+	inline double spinMarginMs() const { return spinMargin.load(std::memory_order_relaxed) / 1000.0; }
+private:
+	static constexpr int64_t BUCKET_US = 10;
+	static constexpr size_t BUCKET_COUNT = 1000; // Last bucket also collects everything past 10 ms.
+
+	// Behind by more than this (e.g. blocked by a file dialog), so continue from now instead of catching up.
+	static constexpr auto MAX_LAG { std::chrono::milliseconds { 100 } };
+
+	void sleepUntil(clock::time_point time);
+	void calibrate(double overshootUs);
+
+	clock::duration period { std::chrono::milliseconds { 16 } };
+	clock::time_point nextFrameTime{};
+
+	// Sleep overshoot, in microseconds.
+	double overshootMean { 0.0 }, overshootVar { 0.0 };
+	std::atomic<double> spinMargin { 1000.0 };
+
+	std::array<std::atomic<uint32_t>, BUCKET_COUNT> errorHistogram{};
+};
\ No newline at end of file
@@ -32,6 +32,14 @@ void OpenGL::updateTexture(uint32_t textureId, uint32_t width, uint32_t height,
     glBindTexture(GL_TEXTURE_2D, textureId);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, data);
 }
+// Data points to the whole texture image, only the given region of it is uploaded.
+void OpenGL::updateTextureRegion(uint32_t textureId, uint32_t textureWidth, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* data)
+{
+    glBindTexture(GL_TEXTURE_2D, textureId);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, textureWidth);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGB, GL_UNSIGNED_BYTE, data + (y * textureWidth + x) * 3);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
 void OpenGL::bindTexture(uint32_t textureId)
 {
     glBindTexture(GL_TEXTURE_2D, textureId);
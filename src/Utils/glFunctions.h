@@ -7,5 +7,6 @@ namespace OpenGL
 	void createTexture(uint32_t& textureId, uint32_t width, uint32_t height, const uint8_t* data = nullptr, bool bilinearFilter = false);
 	void bindTexture(uint32_t textureId);
 	void updateTexture(uint32_t textureId, uint32_t width, uint32_t height, const uint8_t* data);
+	void updateTextureRegion(uint32_t textureId, uint32_t textureWidth, uint32_t x, uint32_t y, uint32_t width, uint32_t height, const uint8_t* data);
 	void setTextureScalingMode(uint32_t textureId, bool bilinear);
 }
\ No newline at end of file
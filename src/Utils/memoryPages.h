@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <memory>
+
+// WRAM, VRAM and cartridge RAM are tracked in 4 KiB pages, so state forks copy only the pages written since the previous fork.
+namespace MemoryPages
+{
+	constexpr uint32_t PAGE_SHIFT = 12;
+	constexpr uint32_t PAGE_SIZE = 1 << PAGE_SHIFT;
+
+	using page = std::array<uint8_t, PAGE_SIZE>;
+	using pageRef = std::shared_ptr<const page>;
+
+	// One bit per page, regions are at most 128 KiB.
+	using dirtyMask = uint64_t;
+	constexpr dirtyMask ALL_DIRTY = ~dirtyMask { 0 };
+
+	constexpr dirtyMask pageBit(uint32_t offset) { return dirtyMask { 1 } << (offset >> PAGE_SHIFT); }
+	constexpr size_t pageCount(size_t size) { return (size + PAGE_SIZE - 1) >> PAGE_SHIFT; }
+}
\ No newline at end of file
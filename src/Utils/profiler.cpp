@@ -0,0 +1,125 @@
+#ifdef MEGABOY_PROFILER
+#include "profiler.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <algorithm>
+
+namespace
+{
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<Profiler::threadData>> threads; // Kept after their thread exits, so totals don't go back.
+
+	// Timestamps are converted using the rate observed since startup.
+	const uint64_t startTicks { Profiler::timestamp() };
+	const auto startTime { std::chrono::steady_clock::now() };
+
+	std::array<uint64_t, Profiler::ZONE_COUNT> lastTotals{};
+	std::array<Profiler::frameBreakdown, Profiler::HISTORY_LENGTH> frameHistory{};
+	size_t historyInd { 0 };
+
+	double ticksPerMicrosecond()
+	{
+		const auto elapsedUs { std::chrono::duration<double, std::micro> { std::chrono::steady_clock::now() - startTime }.count() };
+		return elapsedUs > 0.0 ? static_cast<double>(Profiler::timestamp() - startTicks) / elapsedUs : 1.0;
+	}
+}
+
+namespace Profiler
+{
+	threadData* registerThread()
+	{
+		std::lock_guard lock { registryMutex };
+
+		threads.push_back(std::make_unique<threadData>());
+		threads.back()->threadId = static_cast<uint32_t>(threads.size());
+		return threads.back().get();
+	}
+
+	void frameMark()
+	{
+		std::array<uint64_t, ZONE_COUNT> totals{};
+
+		{
+			std::lock_guard lock { registryMutex };
+
+			for (const auto& thread : threads)
+			{
+				for (size_t i = 0; i < ZONE_COUNT; i++)
+					totals[i] += thread->zoneTicks[i].load(std::memory_order_relaxed);
+			}
+		}
+
+		const double ticksPerMs { ticksPerMicrosecond() * 1000.0 };
+		auto& frame { frameHistory[historyInd] };
+
+		for (size_t i = 0; i < ZONE_COUNT; i++)
+		{
+			frame[i] = static_cast<float>((totals[i] - lastTotals[i]) / ticksPerMs);
+			lastTotals[i] = totals[i];
+		}
+
+		historyInd = (historyInd + 1) % HISTORY_LENGTH;
+	}
+
+	std::array<frameBreakdown, HISTORY_LENGTH> history()
+	{
+		std::array<frameBreakdown, HISTORY_LENGTH> result;
+
+		for (size_t i = 0; i < HISTORY_LENGTH; i++)
+			result[i] = frameHistory[(historyInd + i) % HISTORY_LENGTH];
+
+		return result;
+	}
+
+	bool writeChromeTrace(const std::filesystem::path& path)
+	{
+		std::ofstream st { path };
+
+		if (!st)
+			return false;
+
+		const double tickRate { ticksPerMicrosecond() };
+		std::vector<traceEvent> events;
+		bool firstEvent { true };
+
+		st << "{\"traceEvents\":[\n";
+
+		std::lock_guard lock { registryMutex };
+
+		for (const auto& thread : threads)
+		{
+			const uint64_t endInd { thread->traceWriteInd.load(std::memory_order_acquire) };
+			const uint64_t startInd { endInd > TRACE_RING_SIZE ? endInd - TRACE_RING_SIZE : 0 };
+
+			events.clear();
+
+			for (uint64_t i = startInd; i < endInd; i++)
+				events.push_back(thread->traceRing[i % TRACE_RING_SIZE]);
+
+			// The owning thread keeps recording, entries it wrapped around to while copying may be torn.
+			const uint64_t newEndInd { thread->traceWriteInd.load(std::memory_order_acquire) };
+			const uint64_t overwritten { newEndInd - endInd + 1 };
+			const size_t skipped { static_cast<size_t>(std::min<uint64_t>(overwritten, events.size())) };
+
+			for (size_t i = skipped; i < events.size(); i++)
+			{
+				const auto& event { events[i] };
+
+				if (!firstEvent)
+					st << ",\n";
+
+				st << "{\"name\":\"" << ZONE_NAMES[static_cast<size_t>(event.zone)] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->threadId
+				   << ",\"ts\":" << static_cast<double>(event.start - startTicks) / tickRate
+				   << ",\"dur\":" << static_cast<double>(event.duration) / tickRate << "}";
+
+				firstEvent = false;
+			}
+		}
+
+		st << "\n]}\n";
+		return static_cast<bool>(st);
+	}
+}
+#endif
\ No newline at end of file
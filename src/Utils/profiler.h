@@ -0,0 +1,141 @@
+#pragma once
+#include <cstdint>
+
+// Time spent per component, switched on at compile time with MEGABOY_PROFILER. Without it the macros expand to nothing.
+// Scopes are exclusive: time spent in nested scopes only counts towards the innermost one.
+enum class ProfileZone : uint8_t
+{
+	Frame,
+	CPU,
+	PPU,
+	DMA,
+	APU,
+	Serial,
+	SaveState,
+	TextureUpload,
+	ImGui,
+	Count
+};
+
+#ifdef MEGABOY_PROFILER
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace Profiler
+{
+	constexpr size_t ZONE_COUNT = static_cast<size_t>(ProfileZone::Count);
+	constexpr size_t TRACE_RING_SIZE = 1 << 15;
+	constexpr size_t HISTORY_LENGTH = 240;
+
+	constexpr std::array<const char*, ZONE_COUNT> ZONE_NAMES { "Frame", "CPU", "PPU", "DMA/HDMA", "APU", "Serial", "Save State", "Texture Upload", "ImGui" };
+
+	// Zones entered per cycle only accumulate time, the rest are also recorded for the Chrome trace.
+	constexpr bool isTraced(ProfileZone zone)
+	{
+		return zone == ProfileZone::Frame || zone == ProfileZone::SaveState || zone == ProfileZone::TextureUpload || zone == ProfileZone::ImGui;
+	}
+
+	inline uint64_t timestamp()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	struct traceEvent
+	{
+		uint64_t start;
+		uint64_t duration;
+		ProfileZone zone;
+	};
+
+	// Only written by its own thread, read by frameMark and the trace dump.
+	struct threadData
+	{
+		std::array<std::atomic<uint64_t>, ZONE_COUNT> zoneTicks{};
+		std::array<traceEvent, TRACE_RING_SIZE> traceRing{};
+		std::atomic<uint64_t> traceWriteInd { 0 };
+
+		uint64_t* childTicks { nullptr }; // Of the innermost open scope.
+		uint32_t threadId { 0 };
+	};
+
+	threadData* registerThread();
+
+	inline threadData& currentThread()
+	{
+		static thread_local threadData* data { nullptr };
+
+		if (data == nullptr) [[unlikely]]
+			data = registerThread();
+
+		return *data;
+	}
+
+	template <ProfileZone zone>
+	class Scope
+	{
+	public:
+		Scope() : thread(currentThread()), parentChildTicks(thread.childTicks), start(timestamp())
+		{
+			thread.childTicks = &childTicks;
+		}
+		~Scope()
+		{
+			const uint64_t elapsed { timestamp() - start };
+			auto& ticks { thread.zoneTicks[static_cast<size_t>(zone)] };
+			ticks.store(ticks.load(std::memory_order_relaxed) + (elapsed - childTicks), std::memory_order_relaxed);
+
+			if (parentChildTicks != nullptr)
+				*parentChildTicks += elapsed;
+
+			thread.childTicks = parentChildTicks;
+
+			if constexpr (isTraced(zone))
+			{
+				const uint64_t ind { thread.traceWriteInd.load(std::memory_order_relaxed) };
+				thread.traceRing[ind % TRACE_RING_SIZE] = { start, elapsed, zone };
+				thread.traceWriteInd.store(ind + 1, std::memory_order_release);
+			}
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		threadData& thread;
+		uint64_t* parentChildTicks;
+		uint64_t childTicks { 0 };
+		uint64_t start;
+	};
+
+	// Per frame milliseconds of each zone, summed over all threads.
+	using frameBreakdown = std::array<float, ZONE_COUNT>;
+
+	// Closes the current frame of the rolling history, called once per presented frame.
+	void frameMark();
+
+	// Oldest first.
+	std::array<frameBreakdown, HISTORY_LENGTH> history();
+
+	// Writes recorded trace events in the Chrome trace event format, viewable in chrome://tracing or Perfetto.
+	bool writeChromeTrace(const std::filesystem::path& path);
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(zone) Profiler::Scope<ProfileZone::zone> PROFILE_CONCAT(profileScope, __LINE__)
+#define PROFILE_FRAME_MARK() Profiler::frameMark()
+#else
+#define PROFILE_SCOPE(zone)
+#define PROFILE_FRAME_MARK()
+#endif
\ No newline at end of file
@@ -4,9 +4,16 @@
 
 namespace RngOps
 {
-	inline std::random_device rd;
-	inline std::mt19937 gen(rd()); 
-	inline std::uniform_int_distribution<std::mt19937::result_type> dist(0, 255);
+	// Per thread, so cores emulated on different threads can reset concurrently.
+	inline thread_local std::mt19937 gen(std::random_device{}());
+	inline thread_local std::uniform_int_distribution<std::mt19937::result_type> dist(0, 255);
+
+	// Makes the randomized power-on state reproducible.
+	inline void seed(uint32_t val)
+	{
+		gen.seed(val);
+		dist.reset();
+	}
 
 	inline uint8_t gen8bit()
 	{
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <atomic>
+#include <algorithm>
+
+// Lock-free single producer / single consumer ring buffer. Capacity must be a power of two.
+template <typename T, size_t N>
+class SPSCRing
+{
+	static_assert(N != 0 && (N & (N - 1)) == 0, "SPSCRing capacity must be a power of two.");
+public:
+	static constexpr size_t capacity() { return N; }
+
+	// Producer side. Returns number of elements pushed, which is less than count if the ring is full.
+	size_t push(const T* data, size_t count)
+	{
+		const size_t writePos { head.load(std::memory_order_relaxed) };
+		const size_t readPos { tail.load(std::memory_order_acquire) };
+
+		count = std::min(count, N - (writePos - readPos));
+		const size_t start { writePos & MASK };
+		const size_t firstPart { std::min(count, N - start) };
+
+		std::copy_n(data, firstPart, buffer.begin() + start);
+		std::copy_n(data + firstPart, count - firstPart, buffer.begin());
+
+		head.store(writePos + count, std::memory_order_release);
+		return count;
+	}
+
+	// Consumer side. Returns number of elements popped, which is less than count if the ring is empty.
+	size_t pop(T* out, size_t count)
+	{
+		const size_t readPos { tail.load(std::memory_order_relaxed) };
+		const size_t writePos { head.load(std::memory_order_acquire) };
+
+		count = std::min(count, writePos - readPos);
+		const size_t start { readPos & MASK };
+		const size_t firstPart { std::min(count, N - start) };
+
+		std::copy_n(buffer.begin() + start, firstPart, out);
+		std::copy_n(buffer.begin(), count - firstPart, out + firstPart);
+
+		tail.store(readPos + count, std::memory_order_release);
+		return count;
+	}
+
+	// Consumer side. Discards everything currently in the ring.
+	void clear()
+	{
+		tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+	}
+
+	// Approximate when called from a thread other than producer or consumer.
+	size_t size() const
+	{
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+private:
+	static constexpr size_t MASK = N - 1;
+
+	std::array<T, N> buffer{};
+
+	alignas(64) std::atomic<size_t> head { 0 };
+	alignas(64) std::atomic<size_t> tail { 0 };
+};
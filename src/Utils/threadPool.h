@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Fixed set of worker threads for running the same job over many indices. The calling thread takes part in the work,
+// and each index is handed out once, so uneven jobs are balanced without splitting them up front.
+class ThreadPool
+{
+public:
+	explicit ThreadPool(size_t threadCount)
+	{
+		for (size_t i = 1; i < threadCount; i++)
+			workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard lock { mutex };
+			stopping = true;
+		}
+
+		startCV.notify_all();
+
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	inline size_t threadCount() const { return workers.size() + 1; }
+
+	// Calls job(i) for every i below count, and returns once all of them are done.
+	void parallelFor(size_t count, const std::function<void(size_t)>& job)
+	{
+		if (workers.empty() || count <= 1)
+		{
+			for (size_t i = 0; i < count; i++)
+				job(i);
+
+			return;
+		}
+
+		{
+			std::lock_guard lock { mutex };
+			currentJob = &job;
+			jobCount = count;
+			nextIndex = 0;
+			busyWorkers = workers.size();
+			generation++;
+		}
+
+		startCV.notify_all();
+		runJob();
+
+		std::unique_lock lock { mutex };
+		doneCV.wait(lock, [this] { return busyWorkers == 0; });
+		currentJob = nullptr;
+	}
+private:
+	void runJob()
+	{
+		for (size_t i { nextIndex++ }; i < jobCount; i = nextIndex++)
+			(*currentJob)(i);
+	}
+
+	void workerLoop()
+	{
+		uint64_t seenGeneration { 0 };
+
+		while (true)
+		{
+			{
+				std::unique_lock lock { mutex };
+				startCV.wait(lock, [&] { return stopping || generation != seenGeneration; });
+
+				if (stopping)
+					return;
+
+				seenGeneration = generation;
+			}
+
+			runJob();
+
+			{
+				std::lock_guard lock { mutex };
+				busyWorkers--;
+			}
+
+			doneCV.notify_one();
+		}
+	}
+
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable startCV, doneCV;
+
+	const std::function<void(size_t)>* currentJob { nullptr };
+	size_t jobCount { 0 };
+	std::atomic<size_t> nextIndex { 0 };
+	size_t busyWorkers { 0 };
+	uint64_t generation { 0 };
+	bool stopping { false };
+};
\ No newline at end of file
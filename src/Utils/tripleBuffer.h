@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <atomic>
+
+// Hands the latest value from a producer thread to a consumer thread without locking. Neither side waits,
+// the producer overwrites a value the consumer didn't pick up yet, and the consumer always gets the newest one.
+template <typename T>
+class TripleBuffer
+{
+public:
+	// Producer side.
+	inline T& back() { return buffers[backInd]; }
+
+	inline void publish()
+	{
+		backInd = middle.exchange(backInd | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// True if the last published value wasn't consumed yet.
+	inline bool pending() const { return (middle.load(std::memory_order_acquire) & FRESH_BIT) != 0; }
+
+	// Consumer side. Returns nullptr if nothing was published since the last call.
+	inline const T* consume()
+	{
+		if (!pending())
+			return nullptr;
+
+		frontInd = middle.exchange(frontInd, std::memory_order_acq_rel) & INDEX_MASK;
+		return &buffers[frontInd];
+	}
+private:
+	static constexpr uint8_t INDEX_MASK = 0x3;
+	static constexpr uint8_t FRESH_BIT = 0x4;
+
+	std::array<T, 3> buffers{};
+	std::atomic<uint8_t> middle { 1 };
+
+	uint8_t backInd { 0 }; // Only accessed by the producer.
+	uint8_t frontInd { 2 }; // Only accessed by the consumer.
+};
\ No newline at end of file
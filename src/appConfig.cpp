@@ -1,5 +1,6 @@
 ﻿#include "appConfig.h"
 #include <filesystem>
+#include <algorithm>
 #include <mini/ini.h>
 #include "Utils/fileUtils.h"
 #include "GBCore.h"
@@ -40,6 +41,7 @@ void appConfig::loadConfigFile()
 
 	to_bool(batterySaves, "options", "batterySaves");
 	to_bool(autosaveState, "options", "autosaveState");
+	to_bool(turboFastForward, "options", "turboFastForward");
 	to_bool(loadLastROM, "options", "loadLastROM");
 	to_int(systemPreference, "options", "preferredSystem");
 
@@ -56,6 +58,7 @@ void appConfig::loadConfigFile()
 
 	to_bool(blending, "graphics", "blending");
 	to_bool(vsync, "graphics", "vsync");
+	to_bool(syncToRefreshRate, "graphics", "syncToRefreshRate");
 	to_bool(integerScaling, "graphics", "integerScaling");
 	to_bool(bilinearFiltering, "graphics", "bilinearFiltering");
 	to_bool(gbcColorCorrection, "graphics", "gbcColorCorrection");
@@ -75,6 +78,15 @@ void appConfig::loadConfigFile()
 	}
 
 	to_bool(enableAudio, "audio", "enable");
+	to_int(audioSampleRate, "audio", "sampleRate");
+	to_int(audioResampler, "audio", "resampler");
+	to_int(audioLatency, "audio", "latency");
+	to_bool(recordFLAC, "audio", "recordFLAC");
+
+	audioSampleRate = std::clamp(audioSampleRate, 8000, 192000);
+	audioResampler = std::clamp(audioResampler, 0, 2);
+	audioLatency = std::clamp(audioLatency, 10, 150);
+
 	to_bool(runBootROM, "bootroms", "runBootROM");
 
 #ifndef EMSCRIPTEN
@@ -100,6 +112,7 @@ void appConfig::updateConfigFile()
 
 	config["options"]["batterySaves"] = to_string(batterySaves);
 	config["options"]["autosaveState"] = to_string(autosaveState);
+	config["options"]["turboFastForward"] = to_string(turboFastForward);
 	config["options"]["loadLastROM"] = to_string(loadLastROM);
 	config["options"]["preferredSystem"] = std::to_string(systemPreference);
 
@@ -111,6 +124,7 @@ void appConfig::updateConfigFile()
 
 	config["graphics"]["blending"] = to_string(blending);
 	config["graphics"]["vsync"] = to_string(vsync);
+	config["graphics"]["syncToRefreshRate"] = to_string(syncToRefreshRate);
 	config["graphics"]["integerScaling"] = to_string(integerScaling);
 	config["graphics"]["bilinearFiltering"] = to_string(bilinearFiltering);
 	config["graphics"]["gbcColorCorrection"] = to_string(gbcColorCorrection);
@@ -124,6 +138,10 @@ void appConfig::updateConfigFile()
 	}
 
 	config["audio"]["enable"] = to_string(enableAudio);
+	config["audio"]["sampleRate"] = std::to_string(audioSampleRate);
+	config["audio"]["resampler"] = std::to_string(audioResampler);
+	config["audio"]["latency"] = std::to_string(audioLatency);
+	config["audio"]["recordFLAC"] = to_string(recordFLAC);
 	config["bootroms"]["runBootROM"] = to_string(runBootROM);
 
 #ifndef EMSCRIPTEN
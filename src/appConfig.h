@@ -9,14 +9,20 @@ namespace appConfig
 
 	inline bool autosaveState { true };
 	inline bool batterySaves { true };
+	inline bool turboFastForward { false };
 
 	inline bool blending { true };
 	inline bool vsync { true };
+	inline bool syncToRefreshRate { false };
 	inline bool integerScaling { true };
 	inline bool bilinearFiltering { false };
 	inline bool gbcColorCorrection { false };
 
 	inline bool enableAudio { false };
+	inline int audioSampleRate { 48000 };
+	inline int audioResampler { 1 };
+	inline int audioLatency { 40 };
+	inline bool recordFLAC { false };
 
 	inline int filter { 1 };
 	inline int palette { 0 };
@@ -32,6 +38,12 @@ namespace appConfig
 	inline std::filesystem::path cgbBootRomPath{};
 #endif
 
+#ifdef MEGABOY_HEADLESS
+	// Headless builds have no frontend, the defaults are used and nothing is written.
+	inline void loadConfigFile() {}
+	inline void updateConfigFile() {}
+#else
 	void loadConfigFile();
 	void updateConfigFile();
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,359 @@
+#include <cmath>
+#include <algorithm>
+#include <miniz/miniz.h>
+#include "avRecorder.h"
+
+namespace
+{
+	inline void write16(std::ostream& st, uint16_t val) { st.write(reinterpret_cast<const char*>(&val), sizeof(val)); }
+	inline void write32(std::ostream& st, uint32_t val) { st.write(reinterpret_cast<const char*>(&val), sizeof(val)); }
+	inline void writeFourCC(std::ostream& st, const char* fourCC) { st.write(fourCC, 4); }
+
+	constexpr uint32_t AVIF_HASINDEX = 0x10;
+	constexpr uint32_t AVIF_ISINTERLEAVED = 0x100;
+	constexpr uint32_t AVIIF_KEYFRAME = 0x10;
+
+	constexpr int PNG_COMPRESSION_LEVEL = 3;
+}
+
+bool AVRecorder::start(const std::filesystem::path& filePath, uint16_t frameWidth, uint16_t frameHeight, uint32_t rateNum, uint32_t rateDen, uint32_t audioSampleRate)
+{
+	stop();
+
+	stream = std::ofstream { filePath, std::ios::binary };
+
+	if (!stream)
+		return false;
+
+	width = frameWidth;
+	height = frameHeight;
+	frameRateNum = rateNum;
+	frameRateDen = rateDen;
+	sampleRate = audioSampleRate;
+
+	index.clear();
+	listStarts.clear();
+	submittedFrames = 0;
+	encodedFrames = 0;
+	encodedAudioFrames = 0;
+
+	freeSlots.clear();
+	queuedSlots.clear();
+	filledSlot = -1;
+
+	for (size_t i = 0; i < SLOT_COUNT; i++)
+	{
+		slots[i].pixels.resize(static_cast<size_t>(width) * height * 3);
+		slots[i].audio.clear();
+		freeSlots.push_back(i);
+	}
+
+	writeHeaders();
+
+	stopRequested = false;
+	recording = true;
+
+#ifndef EMSCRIPTEN
+	encoderThread = std::thread { &AVRecorder::encoderLoop, this };
+#endif
+	return true;
+}
+
+void AVRecorder::stop()
+{
+	if (!recording)
+		return;
+
+	recording = false;
+
+#ifndef EMSCRIPTEN
+	{
+		std::lock_guard lock { slotMutex };
+		stopRequested = true;
+	}
+
+	slotCV.notify_all();
+	encoderThread.join();
+#endif
+
+	// Audio without a frame to go with it is dropped.
+	filledSlot = -1;
+	finalize();
+}
+
+AVRecorder::frameSlot& AVRecorder::fillingSlot()
+{
+	if (filledSlot < 0)
+	{
+		std::unique_lock lock { slotMutex };
+
+		// Only waits if the encoder falls behind by a whole set of slots.
+		slotCV.wait(lock, [this] { return !freeSlots.empty(); });
+
+		filledSlot = static_cast<int>(freeSlots.front());
+		freeSlots.pop_front();
+		slots[filledSlot].audio.clear();
+	}
+
+	return slots[filledSlot];
+}
+
+void AVRecorder::addAudio(const int16_t* samples, size_t frames)
+{
+	auto& slot { fillingSlot() };
+	slot.audio.insert(slot.audio.end(), samples, samples + frames * CHANNELS);
+}
+
+void AVRecorder::addVideoFrame(const uint8_t* rgbPixels, bool frameChanged)
+{
+	auto& slot { fillingSlot() };
+	slot.repeat = !frameChanged && submittedFrames > 0;
+
+	if (!slot.repeat)
+		std::copy_n(rgbPixels, slot.pixels.size(), slot.pixels.begin());
+
+	submittedFrames++;
+
+#ifdef EMSCRIPTEN
+	encodeSlot(slot);
+	freeSlots.push_back(static_cast<size_t>(filledSlot));
+#else
+	{
+		std::lock_guard lock { slotMutex };
+		queuedSlots.push_back(static_cast<size_t>(filledSlot));
+	}
+
+	slotCV.notify_all();
+#endif
+
+	filledSlot = -1;
+}
+
+void AVRecorder::encoderLoop()
+{
+	while (true)
+	{
+		std::unique_lock lock { slotMutex };
+		slotCV.wait(lock, [this] { return !queuedSlots.empty() || stopRequested; });
+
+		// Queued frames are still written after a stop request.
+		if (queuedSlots.empty())
+			return;
+
+		const size_t slotInd { queuedSlots.front() };
+		queuedSlots.pop_front();
+		lock.unlock();
+
+		encodeSlot(slots[slotInd]);
+
+		lock.lock();
+		freeSlots.push_back(slotInd);
+		lock.unlock();
+		slotCV.notify_all();
+	}
+}
+
+void AVRecorder::encodeSlot(frameSlot& slot)
+{
+	if (static_cast<uint64_t>(stream.tellp()) > MAX_FILE_SIZE) [[unlikely]]
+		return;
+
+	if (slot.repeat)
+	{
+		writeChunk("00dc", nullptr, 0, false);
+		encodedFrames++;
+	}
+	else
+	{
+		size_t pngSize { 0 };
+		void* png { tdefl_write_image_to_png_file_in_memory_ex(slot.pixels.data(), width, height, 3, &pngSize, PNG_COMPRESSION_LEVEL, false) };
+
+		if (png != nullptr)
+		{
+			writeChunk("00dc", png, static_cast<uint32_t>(pngSize));
+			mz_free(png);
+			encodedFrames++;
+		}
+	}
+
+	if (!slot.audio.empty())
+	{
+		writeChunk("01wb", slot.audio.data(), static_cast<uint32_t>(slot.audio.size() * sizeof(int16_t)));
+		encodedAudioFrames += slot.audio.size() / CHANNELS;
+	}
+}
+
+void AVRecorder::writeChunk(const char* id, const void* data, uint32_t size, bool keyframe)
+{
+	index.push_back({ { id[0], id[1], id[2], id[3] }, keyframe ? AVIIF_KEYFRAME : 0, static_cast<uint32_t>(stream.tellp() - moviStart), size });
+
+	writeFourCC(stream, id);
+	write32(stream, size);
+	stream.write(static_cast<const char*>(data), size);
+
+	// Chunks are word aligned.
+	if (size & 1)
+		stream.put(0);
+}
+
+void AVRecorder::beginList(const char* type)
+{
+	writeFourCC(stream, "LIST");
+	listStarts.push_back(stream.tellp());
+	write32(stream, 0);
+	writeFourCC(stream, type);
+}
+
+void AVRecorder::endList()
+{
+	const std::streamoff sizeOffset { listStarts.back() };
+	listStarts.pop_back();
+
+	const std::streamoff end { stream.tellp() };
+	stream.seekp(sizeOffset);
+	write32(stream, static_cast<uint32_t>(end - sizeOffset - 4));
+	stream.seekp(end);
+}
+
+void AVRecorder::writeHeaders()
+{
+	constexpr uint32_t MAIN_HEADER_SIZE = 56;
+	constexpr uint32_t STREAM_HEADER_SIZE = 56;
+	constexpr uint32_t BITMAP_INFO_SIZE = 40;
+	constexpr uint32_t WAVE_FORMAT_SIZE = 18;
+	constexpr uint16_t BLOCK_ALIGN = CHANNELS * sizeof(int16_t);
+
+	const uint32_t frameSize { static_cast<uint32_t>(width) * height * 3 };
+	const uint32_t audioBytesPerSecond { sampleRate * BLOCK_ALIGN };
+
+	writeFourCC(stream, "RIFF");
+	write32(stream, 0);
+	writeFourCC(stream, "AVI ");
+
+	beginList("hdrl");
+	{
+		writeFourCC(stream, "avih");
+		write32(stream, MAIN_HEADER_SIZE);
+		write32(stream, static_cast<uint32_t>(std::lround(1000000.0 * frameRateDen / frameRateNum)));
+		write32(stream, static_cast<uint32_t>(static_cast<uint64_t>(frameSize) * frameRateNum / frameRateDen + audioBytesPerSecond));
+		write32(stream, 0); // Padding granularity
+		write32(stream, AVIF_HASINDEX | AVIF_ISINTERLEAVED);
+		totalFramesOffset = stream.tellp();
+		write32(stream, 0); // Total frames
+		write32(stream, 0); // Initial frames
+		write32(stream, 2); // Streams
+		write32(stream, frameSize); // Suggested buffer size
+		write32(stream, width);
+		write32(stream, height);
+
+		for (int i = 0; i < 4; i++)
+			write32(stream, 0);
+
+		beginList("strl");
+		{
+			writeFourCC(stream, "strh");
+			write32(stream, STREAM_HEADER_SIZE);
+			writeFourCC(stream, "vids");
+			writeFourCC(stream, "MPNG");
+			write32(stream, 0); // Flags
+			write16(stream, 0); // Priority
+			write16(stream, 0); // Language
+			write32(stream, 0); // Initial frames
+			write32(stream, frameRateDen); // Scale
+			write32(stream, frameRateNum); // Rate
+			write32(stream, 0); // Start
+			videoLengthOffset = stream.tellp();
+			write32(stream, 0); // Length
+			write32(stream, frameSize);
+			write32(stream, UINT32_MAX); // Quality, default
+			write32(stream, 0); // Sample size, varies
+			write16(stream, 0);
+			write16(stream, 0);
+			write16(stream, width);
+			write16(stream, height);
+
+			writeFourCC(stream, "strf");
+			write32(stream, BITMAP_INFO_SIZE);
+			write32(stream, BITMAP_INFO_SIZE);
+			write32(stream, width);
+			write32(stream, height);
+			write16(stream, 1); // Planes
+			write16(stream, 24); // Bits per pixel
+			writeFourCC(stream, "MPNG");
+			write32(stream, frameSize);
+
+			for (int i = 0; i < 4; i++)
+				write32(stream, 0);
+		}
+		endList();
+
+		beginList("strl");
+		{
+			writeFourCC(stream, "strh");
+			write32(stream, STREAM_HEADER_SIZE);
+			writeFourCC(stream, "auds");
+			write32(stream, 0); // Handler
+			write32(stream, 0); // Flags
+			write16(stream, 0); // Priority
+			write16(stream, 0); // Language
+			write32(stream, 0); // Initial frames
+			write32(stream, BLOCK_ALIGN); // Scale
+			write32(stream, audioBytesPerSecond); // Rate
+			write32(stream, 0); // Start
+			audioLengthOffset = stream.tellp();
+			write32(stream, 0); // Length, in sample frames
+			write32(stream, audioBytesPerSecond / 10);
+			write32(stream, UINT32_MAX); // Quality, default
+			write32(stream, BLOCK_ALIGN); // Sample size
+			write32(stream, 0);
+			write32(stream, 0);
+
+			writeFourCC(stream, "strf");
+			write32(stream, WAVE_FORMAT_SIZE);
+			write16(stream, 1); // PCM
+			write16(stream, CHANNELS);
+			write32(stream, sampleRate);
+			write32(stream, audioBytesPerSecond);
+			write16(stream, BLOCK_ALIGN);
+			write16(stream, sizeof(int16_t) * 8);
+			write16(stream, 0); // Extra format bytes
+		}
+		endList();
+	}
+	endList();
+
+	beginList("movi");
+	moviStart = stream.tellp() - std::streamoff { 4 }; // Index offsets are relative to the 'movi' FourCC.
+}
+
+void AVRecorder::finalize()
+{
+	endList(); // movi
+
+	writeFourCC(stream, "idx1");
+	write32(stream, static_cast<uint32_t>(index.size() * 16));
+
+	for (const auto& entry : index)
+	{
+		stream.write(entry.id.data(), 4);
+		write32(stream, entry.flags);
+		write32(stream, entry.offset);
+		write32(stream, entry.size);
+	}
+
+	const std::streamoff fileSize { stream.tellp() };
+
+	stream.seekp(4);
+	write32(stream, static_cast<uint32_t>(fileSize - 8));
+
+	stream.seekp(totalFramesOffset);
+	write32(stream, static_cast<uint32_t>(encodedFrames));
+
+	stream.seekp(videoLengthOffset);
+	write32(stream, static_cast<uint32_t>(encodedFrames));
+
+	stream.seekp(audioLengthOffset);
+	write32(stream, static_cast<uint32_t>(encodedAudioFrames));
+
+	stream.close();
+}
\ No newline at end of file
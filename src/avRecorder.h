@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+// Records frames and the audio produced during each of them into an AVI file, with PNG compressed video and 16 bit stereo PCM audio.
+// The emulation thread only copies data into a free slot, compression and file writes happen on an encoder thread.
+class AVRecorder
+{
+public:
+	~AVRecorder() { stop(); }
+
+	// Frame rate is frameRateNum / frameRateDen frames per second.
+	bool start(const std::filesystem::path& filePath, uint16_t width, uint16_t height, uint32_t frameRateNum, uint32_t frameRateDen, uint32_t sampleRate);
+	void stop();
+
+	inline bool active() const { return recording; }
+
+	// Audio is attached to the next submitted frame.
+	void addAudio(const int16_t* samples, size_t frames);
+	// Unchanged frames are written as empty drop frame chunks, players repeat the previous frame for them.
+	void addVideoFrame(const uint8_t* rgbPixels, bool frameChanged);
+
+	inline float recordedSeconds() const { return static_cast<float>(static_cast<double>(submittedFrames) * frameRateDen / frameRateNum); }
+private:
+	struct frameSlot
+	{
+		std::vector<uint8_t> pixels;
+		std::vector<int16_t> audio;
+		bool repeat { false };
+	};
+
+	struct indexEntry
+	{
+		std::array<char, 4> id;
+		uint32_t flags, offset, size;
+	};
+
+	static constexpr size_t SLOT_COUNT = 8;
+	static constexpr uint16_t CHANNELS = 2;
+
+	// AVI 1.0 chunk offsets are 32 bit, later chunks are dropped.
+	static constexpr uint64_t MAX_FILE_SIZE = 0x7F000000;
+
+	frameSlot& fillingSlot();
+	void encoderLoop();
+	void encodeSlot(frameSlot& slot);
+
+	void writeChunk(const char* id, const void* data, uint32_t size, bool keyframe = true);
+	void beginList(const char* type);
+	void endList();
+
+	void writeHeaders();
+	void finalize();
+
+	std::array<frameSlot, SLOT_COUNT> slots;
+	std::deque<size_t> freeSlots, queuedSlots;
+	int filledSlot { -1 }; // Slot collecting data for the next frame, only accessed by the emulation thread.
+
+	std::thread encoderThread;
+	std::mutex slotMutex;
+	std::condition_variable slotCV;
+	bool stopRequested { false };
+	std::atomic<bool> recording { false };
+
+	std::ofstream stream;
+	std::vector<std::streamoff> listStarts;
+	std::vector<indexEntry> index;
+
+	std::streamoff moviStart{};
+	std::streamoff totalFramesOffset{}, videoLengthOffset{}, audioLengthOffset{};
+
+	uint16_t width{}, height{};
+	uint32_t frameRateNum { 1 }, frameRateDen { 1 }, sampleRate { 1 };
+
+	std::atomic<uint64_t> submittedFrames { 0 };
+	uint64_t encodedFrames{}, encodedAudioFrames{}; // Only accessed by the encoder.
+};
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cctype>
+#include "benchmark.h"
+#include "GBCore.h"
+#include "Utils/rngOps.h"
+
+namespace
+{
+	constexpr uint32_t RNG_SEED = 0x4D42;
+	constexpr uint64_t RTC_TIME = 1704067200; // 2024-01-01 00:00 UTC
+
+	// Keeps a movie whose end was not reached (for example, it stopped on a breakpoint) from running forever.
+	constexpr uint32_t MAX_MOVIE_FRAMES = 60 * 60 * 60;
+
+	bool isWorkloadFile(const std::filesystem::path& path)
+	{
+		auto ext { path.extension().string() };
+		std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return ext == ".gb" || ext == ".gbc" || ext == ".mbm";
+	}
+
+	void printLine(std::ostream& report, const std::string& name, const char* system, uint64_t frames, double seconds)
+	{
+		const double emulatedSeconds { static_cast<double>(frames) * GBCore::CYCLES_PER_FRAME / GBCore::CYCLES_PER_SECOND };
+
+		std::array<char, 160> line;
+		const int len { std::snprintf(line.data(), line.size(), "%-40.40s %-3s %8llu frames %8.3f s %9.1f fps %7.2fx\n", name.c_str(), system,
+			static_cast<unsigned long long>(frames), seconds, frames / seconds, emulatedSeconds / seconds) };
+
+		report.write(line.data(), std::min<int>(len, static_cast<int>(line.size()) - 1));
+	}
+}
+
+bool Benchmark::run(GBCore& gb, const std::filesystem::path& workloadDir, std::ostream& report)
+{
+	std::error_code err;
+	std::vector<std::filesystem::path> files;
+
+	for (const auto& entry : std::filesystem::directory_iterator { workloadDir, err })
+	{
+		if (entry.is_regular_file(err) && isWorkloadFile(entry.path()))
+			files.push_back(entry.path());
+	}
+
+	if (files.empty())
+	{
+		report << "No .gb, .gbc or .mbm files in " << workloadDir.string() << "\n";
+		return false;
+	}
+
+	// Directory order is unspecified.
+	std::sort(files.begin(), files.end());
+
+	bool success { true };
+	uint64_t totalFrames { 0 };
+	double totalSeconds { 0.0 };
+
+	for (const auto& path : files)
+	{
+		RngOps::seed(RNG_SEED);
+		RTC::fixedUnixTime = RTC_TIME;
+
+		// Movies set their own RTC time and load the ROM they were recorded with.
+		const auto result { gb.loadFile(path, false) };
+		const bool isMovie { result == FileLoadResult::SuccessMovie };
+
+		if (result != FileLoadResult::SuccessROM && !isMovie)
+		{
+			report << "Failed to load " << path.filename().string() << "\n";
+			success = false;
+			continue;
+		}
+
+		uint64_t frames { 0 };
+		const auto start { std::chrono::steady_clock::now() };
+
+		if (isMovie)
+		{
+			while (gb.isMoviePlaying() && frames < MAX_MOVIE_FRAMES)
+			{
+				gb.emulateFrame();
+				frames++;
+			}
+		}
+		else
+		{
+			for (; frames < ROM_FRAMES; frames++)
+				gb.emulateFrame();
+		}
+
+		const double seconds { std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+
+		printLine(report, path.filename().string(), System::IsCGBDevice(System::Current()) ? "CGB" : "DMG", frames, seconds);
+		totalFrames += frames;
+		totalSeconds += seconds;
+
+		if (isMovie)
+			gb.stopMovie();
+	}
+
+	RTC::fixedUnixTime.reset();
+
+	if (totalFrames != 0)
+		printLine(report, "Total", "", totalFrames, totalSeconds);
+
+	return success;
+}
\ No newline at end of file
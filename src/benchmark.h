@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+
+class GBCore;
+
+// Headless runs of a fixed workload, for measuring emulation speed and as the training run of profile-guided optimization builds.
+// Every .gb/.gbc file in the workload directory runs for ROM_FRAMES frames from power-on, and every .mbm input movie plays to its end.
+// The power-on RNG seed and RTC time are fixed, so each run executes exactly the same instructions.
+namespace Benchmark
+{
+	constexpr uint32_t ROM_FRAMES = 3600;
+
+	// Prints one line per file and the totals. Returns false if any file failed to load or none were found.
+	bool run(GBCore& gb, const std::filesystem::path& workloadDir, std::ostream& report);
+}
\ No newline at end of file
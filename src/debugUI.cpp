@@ -4,6 +4,7 @@
 #include "debugUI.h"
 #include "Utils/bitOps.h"
 #include "Utils/glFunctions.h"
+#include "Utils/profiler.h"
 
 extern GBCore gb;
 
@@ -43,6 +44,16 @@ void debugUI::renderMenu()
         {
             showAudioView = !showAudioView;
         }
+        if (ImGui::MenuItem("PC Profiler"))
+        {
+            showPCProfilerView = !showPCProfilerView;
+        }
+#if defined(MEGABOY_PROFILER) || !defined(EMSCRIPTEN)
+        if (ImGui::MenuItem("Profiler"))
+        {
+            showProfilerView = !showProfilerView;
+        }
+#endif
 
         ImGui::EndMenu();
     }
@@ -82,6 +93,25 @@ void debugUI::signalSaveStateChange()
     showBreakpointHitWindow = false;
 }
 
+// Colors and tile addressing of the views also depend on palettes and LCDC, whole view is redrawn when these change.
+std::vector<uint8_t> debugUI::vramViewKey(bool tileMap)
+{
+    const auto colors { reinterpret_cast<const uint8_t*>(PPU::ColorPalette) };
+    std::vector<uint8_t> key(colors, colors + sizeof(color) * 4);
+
+    if (!tileMap)
+    {
+        key.push_back(static_cast<uint8_t>(vramTileBank));
+        return key;
+    }
+
+    key.push_back(getBit(gb.ppu->regs.LCDC, 4));
+    key.push_back(gb.ppu->regs.BGP);
+    key.push_back(appConfig::gbcColorCorrection);
+    key.insert(key.end(), gb.ppu->gbcRegs.BCPS.RAM.begin(), gb.ppu->gbcRegs.BCPS.RAM.end());
+    return key;
+}
+
 void debugUI::refreshCurrentVRAMTab()
 {
     if (!gb.executingProgram())
@@ -95,35 +125,52 @@ void debugUI::refreshCurrentVRAMTab()
             OpenGL::updateTexture(texture, width, height, data);
     };
 
+    // Only tiles changed since the last refresh are redrawn and uploaded.
+    const auto refreshView = [](uint32_t& texture, uint16_t width, uint16_t height, std::unique_ptr<uint8_t[]>& framebuffer, std::vector<uint8_t>& lastKey, bool tileMap, const auto& render)
+    {
+        if (!framebuffer)
+            framebuffer = std::make_unique<uint8_t[]>(width * height * 3);
+
+        auto key { vramViewKey(tileMap) };
+        const bool redrawAll { !texture || key != lastKey };
+        lastKey = std::move(key);
+
+        const debugViewRect rect { render(framebuffer.get(), redrawAll) };
+
+        if (!texture)
+            OpenGL::createTexture(texture, width, height, framebuffer.get());
+        else if (!rect.empty())
+            OpenGL::updateTextureRegion(texture, width, rect.x, rect.y, rect.width, rect.height, framebuffer.get());
+    };
+
     switch (currentVramTab)
     {
     case VRAMTab::TileData:
-        if (!tileDataFramebuffer)
-            tileDataFramebuffer = std::make_unique<uint8_t[]>(PPU::TILEDATA_FRAMEBUFFER_SIZE);
-
-        gb.ppu->renderTileData(tileDataFramebuffer.get(), System::Current() == GBSystem::CGB ? vramTileBank : 0);
-        updateTexture(tileDataTexture, PPU::TILES_WIDTH, PPU::TILES_HEIGHT, tileDataFramebuffer.get());
+        refreshView(tileDataTexture, PPU::TILES_WIDTH, PPU::TILES_HEIGHT, tileDataFramebuffer, tileDataViewKey, false, [](uint8_t* buffer, bool redrawAll)
+        { 
+            return gb.ppu->renderTileData(buffer, System::Current() == GBSystem::CGB ? vramTileBank : 0, redrawAll); 
+        });
         break;
     case VRAMTab::TileMap9800:
-        if (!map9800Framebuffer)
-            map9800Framebuffer = std::make_unique<uint8_t[]>(PPU::TILEMAP_FRAMEBUFFER_SIZE);
-
-        gb.ppu->renderTileMap(map9800Framebuffer.get(), 0x9800);
-        updateTexture(map9800Texture, PPU::TILEMAP_WIDTH, PPU::TILEMAP_HEIGHT, map9800Framebuffer.get());
+        refreshView(map9800Texture, PPU::TILEMAP_WIDTH, PPU::TILEMAP_HEIGHT, map9800Framebuffer, map9800ViewKey, true, [](uint8_t* buffer, bool redrawAll)
+        { 
+            return gb.ppu->renderTileMap(buffer, 0x9800, redrawAll); 
+        });
         break;
     case VRAMTab::TileMap9C00:
-        if (!map9C00Framebuffer)
-            map9C00Framebuffer = std::make_unique<uint8_t[]>(PPU::TILEMAP_FRAMEBUFFER_SIZE);
-
-        gb.ppu->renderTileMap(map9C00Framebuffer.get(), 0x9C00);
-        updateTexture(map9C00Texture, PPU::TILEMAP_WIDTH, PPU::TILEMAP_HEIGHT, map9C00Framebuffer.get());
+        refreshView(map9C00Texture, PPU::TILEMAP_WIDTH, PPU::TILEMAP_HEIGHT, map9C00Framebuffer, map9C00ViewKey, true, [](uint8_t* buffer, bool redrawAll)
+        { 
+            return gb.ppu->renderTileMap(buffer, 0x9C00, redrawAll); 
+        });
         break;
     case VRAMTab::PPUOutput:
-        updateTexture(oamTexture, PPU::SCR_WIDTH, PPU::SCR_HEIGHT, gb.ppu->oamFramebuffer());
+        // PPU redraws the object layer only after something it depends on has changed.
+        if (!oamTexture || gb.ppu->takeOAMViewRedraw())
+            updateTexture(oamTexture, PPU::SCR_WIDTH, PPU::SCR_HEIGHT, gb.ppu->oamFramebuffer());
+
         updateTexture(backgroundTexture, PPU::SCR_WIDTH, PPU::SCR_HEIGHT, gb.ppu->bgFramebuffer());
         updateTexture(windowTexture, PPU::SCR_WIDTH, PPU::SCR_HEIGHT, gb.ppu->windowFramebuffer());
 
-        clearBuffer(gb.ppu->oamFramebuffer());
         clearBuffer(gb.ppu->bgFramebuffer());
         clearBuffer(gb.ppu->windowFramebuffer());
         break;
@@ -1276,13 +1323,131 @@ void debugUI::renderWindows(float scaleFactor)
             for (int i = 0; i < 4; i++)
             {
                 const auto channelStr { "Channel " + std::to_string(i + 1) };
-                bool tempFlag { gb.apu.enabledChannels[i].load() };
+                ImGui::Checkbox(channelStr.c_str(), &gb.apu.enabledChannels[i]);
+            }
+
+            ImGui::SeparatorText("Output");
+
+            ImGui::Text("Latency: %.1f ms (target %d ms)", gb.apu.getBufferedLatency(), gb.apu.getTargetLatency());
+            ImGui::Text("Resample ratio: %.5f", gb.apu.getResampleRatio());
+            ImGui::Text("Underruns: %u", gb.apu.underruns.load());
+            ImGui::Text("Overruns: %u", gb.apu.overruns.load());
+
+            if (ImGui::Button("Reset Counters"))
+                gb.apu.resetAudioStats();
+        }
+
+        ImGui::End();
+    }
+    if (showPCProfilerView)
+    {
+        if (ImGui::Begin("PC Profiler", &showPCProfilerView, ImGuiWindowFlags_AlwaysAutoResize))
+        {
+            constexpr size_t HOT_SPOT_COUNT = 32;
+            constexpr double REFRESH_INTERVAL = 0.5;
+
+            if (gb.isPCProfiling())
+            {
+                if (ImGui::Button("Stop"))
+                {
+                    gb.stopPCProfiler();
+                    hotSpotLines.clear();
+                }
+
+                ImGui::SameLine();
+
+                if (ImGui::Button("Clear"))
+                    gb.pcProfiler.clear();
+
+                // Scanning the counters takes a while on large ROMs, so the list isn't rebuilt every frame.
+                if (ImGui::GetTime() - lastHotSpotRefresh >= REFRESH_INTERVAL)
+                {
+                    hotSpotLines.clear();
+
+                    for (const auto& spot : gb.pcProfiler.topSpots(HOT_SPOT_COUNT))
+                        hotSpotLines.push_back(gb.describeHotSpot(spot));
 
-                if (ImGui::Checkbox(channelStr.c_str(), &tempFlag))
-                    gb.apu.enabledChannels[i].store(tempFlag);
+                    lastHotSpotRefresh = ImGui::GetTime();
+                }
             }
+            else
+            {
+                if (!gb.cartridge.loaded()) ImGui::BeginDisabled();
+
+                if (ImGui::Button("Start"))
+                {
+                    gb.startPCProfiler();
+                    lastHotSpotRefresh = 0.0;
+                }
+
+                if (!gb.cartridge.loaded()) ImGui::EndDisabled();
+            }
+
+            ImGui::SeparatorText("Hot Spots (T-cycles)");
+
+            for (const auto& line : hotSpotLines)
+                ImGui::TextUnformatted(line.c_str());
+        }
+
+        ImGui::End();
+    }
+#if defined(MEGABOY_PROFILER) || !defined(EMSCRIPTEN)
+    if (showProfilerView)
+    {
+        if (ImGui::Begin("Profiler", &showProfilerView, ImGuiWindowFlags_AlwaysAutoResize))
+        {
+#ifndef EMSCRIPTEN
+            ImGui::SeparatorText("Frame start error");
+            ImGui::Text("p50: %.2f ms, p99: %.2f ms, max: %.2f ms", framePacing.p50, framePacing.p99, framePacing.max);
+#endif
+#ifdef MEGABOY_PROFILER
+            const auto history { Profiler::history() };
+
+            std::array<float, Profiler::HISTORY_LENGTH> frameTotals{};
+            std::array<float, Profiler::ZONE_COUNT> zoneAverages{}, zoneMaximums{};
+
+            for (size_t i = 0; i < Profiler::HISTORY_LENGTH; i++)
+            {
+                for (size_t zone = 0; zone < Profiler::ZONE_COUNT; zone++)
+                {
+                    frameTotals[i] += history[i][zone];
+                    zoneAverages[zone] += history[i][zone] / Profiler::HISTORY_LENGTH;
+                    zoneMaximums[zone] = std::max(zoneMaximums[zone], history[i][zone]);
+                }
+            }
+
+            ImGui::PlotLines("##frameTotals", frameTotals.data(), static_cast<int>(frameTotals.size()), 0, "Total per frame (ms)", 0.0f, FLT_MAX, ImVec2(0, 60 * scaleFactor));
+
+            if (ImGui::BeginTable("##zones", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+            {
+                ImGui::TableSetupColumn("Zone");
+                ImGui::TableSetupColumn("Avg ms");
+                ImGui::TableSetupColumn("Max ms");
+                ImGui::TableHeadersRow();
+
+                for (size_t zone = 0; zone < Profiler::ZONE_COUNT; zone++)
+                {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(Profiler::ZONE_NAMES[zone]);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", zoneAverages[zone]);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.3f", zoneMaximums[zone]);
+                }
+
+                ImGui::EndTable();
+            }
+
+            if (ImGui::Button("Save Chrome Trace"))
+                Profiler::writeChromeTrace(FileUtils::executableFolderPath / "profile_trace.json");
+
+            if (ImGui::IsItemHovered())
+                ImGui::SetTooltip("Written next to the executable, open in chrome://tracing or ui.perfetto.dev");
+#endif
         }
 
         ImGui::End();
     }
+#endif
 }
\ No newline at end of file
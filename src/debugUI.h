@@ -2,6 +2,7 @@
 
 #include "GBCore.h"
 #include "Utils/pixelOps.h"
+#include "Utils/framePacer.h"
 
 #include <string>
 #include <memory>
@@ -18,6 +19,9 @@ public:
 	static void signalSaveStateChange();
 	static void signalBreakpoint();
 
+	// Emulation thread frame start error over the last second, shown in the profiler window.
+	static inline void updateFramePacing(const FramePacer::jitterStats& stats) { framePacing = stats; }
+
 private:
 	enum class VRAMTab 
 	{
@@ -56,6 +60,13 @@ private:
 	static inline bool showPPUView { false };
 	static inline bool showPaletteView { false };
 	static inline bool showAudioView { false };
+	static inline bool showProfilerView { false };
+	static inline bool showPCProfilerView { false };
+
+	static inline FramePacer::jitterStats framePacing{};
+
+	static inline std::vector<std::string> hotSpotLines;
+	static inline double lastHotSpotRefresh { 0.0 };
 
 	static inline bool showVRAMView { false };
 	static inline auto currentVramTab { VRAMTab::TileData };
@@ -65,6 +76,10 @@ private:
 	static inline std::unique_ptr<uint8_t[]> map9C00Framebuffer;
 	static inline std::unique_ptr<uint8_t[]> tileDataFramebuffer;
 
+	static inline std::vector<uint8_t> map9800ViewKey;
+	static inline std::vector<uint8_t> map9C00ViewKey;
+	static inline std::vector<uint8_t> tileDataViewKey;
+
 	static inline uint32_t map9800Texture {0};
 	static inline uint32_t map9C00Texture {0};
 	static inline uint32_t tileDataTexture {0};
@@ -86,6 +101,7 @@ private:
 	static inline int32_t stepOutStartSPVal { -1 };
 
 	static inline void refreshCurrentVRAMTab();
+	static inline std::vector<uint8_t> vramViewKey(bool tileMap);
 	static inline void disassembleRom();
 	static inline void removeTempBreakpoint();
 	static inline void extendBreakpointDisasmWindow();
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include "inputMovie.h"
+#include "defines.h"
+#include "Utils/fileUtils.h"
+
+// Movie file format:
+// 19 byte signature
+// 2 byte version
+// 1 byte start type (MovieStart enum), 1 byte GB system type (GBSystem enum), 1 byte boot ROM flag
+// 1 byte ROM cartridge header checksum
+// 2 byte ROM file path (UTF-8) length
+// N byte ROM file path
+// 4 byte RNG seed
+// 8 byte RTC unix time
+// 8 byte start cycle, 8 byte end cycle
+// 4 byte start data size, N byte start data (battery save or save state file)
+// 4 byte input event count, then 9 bytes per event: 8 byte cycle, 1 byte joypad state
+// 4 byte keyframe count, then per keyframe: 8 byte cycle, 4 byte event index, 1 byte joypad state,
+//	 4 byte uncompressed state size, 4 byte compressed state size, N byte deflate compressed GB state data
+
+const InputMovie::keyframe* InputMovie::findKeyframe(uint64_t cycle) const
+{
+	const auto it { std::ranges::upper_bound(keyframes, cycle, {}, &keyframe::cycle) };
+	return it == keyframes.begin() ? nullptr : &*std::prev(it);
+}
+
+bool InputMovie::isMovieFile(std::istream& st)
+{
+	std::string fileSignature(SIGNATURE.length(), 0);
+	st.read(fileSignature.data(), SIGNATURE.length());
+	return fileSignature == SIGNATURE;
+}
+
+void InputMovie::write(std::ostream& st) const
+{
+	st.write(SIGNATURE.data(), SIGNATURE.length());
+	ST_WRITE(VERSION);
+
+	ST_WRITE(start);
+	ST_WRITE(system);
+	ST_WRITE(bootROM);
+	ST_WRITE(romChecksum);
+
+	const auto pathLen { static_cast<uint16_t>(romPath.length()) };
+	ST_WRITE(pathLen);
+	st.write(romPath.data(), pathLen);
+
+	ST_WRITE(rngSeed);
+	ST_WRITE(rtcTime);
+	ST_WRITE(startCycle);
+	ST_WRITE(endCycle);
+
+	const auto startDataSize { static_cast<uint32_t>(startData.size()) };
+	ST_WRITE(startDataSize);
+	st.write(reinterpret_cast<const char*>(startData.data()), startDataSize);
+
+	const auto eventCount { static_cast<uint32_t>(events.size()) };
+	ST_WRITE(eventCount);
+
+	for (const auto& event : events)
+	{
+		ST_WRITE(event.cycle);
+		ST_WRITE(event.state);
+	}
+
+	const auto keyframeCount { static_cast<uint32_t>(keyframes.size()) };
+	ST_WRITE(keyframeCount);
+
+	for (const auto& frame : keyframes)
+	{
+		ST_WRITE(frame.cycle);
+		ST_WRITE(frame.eventIndex);
+		ST_WRITE(frame.inputState);
+		ST_WRITE(frame.stateSize);
+
+		const auto dataSize { static_cast<uint32_t>(frame.data.size()) };
+		ST_WRITE(dataSize);
+		st.write(reinterpret_cast<const char*>(frame.data.data()), dataSize);
+	}
+}
+
+bool InputMovie::read(std::istream& st)
+{
+	if (!isMovieFile(st))
+		return false;
+
+	uint16_t version;
+	ST_READ(version);
+
+	if (!st || version != VERSION)
+		return false;
+
+	uint8_t bootROMFlag;
+
+	ST_READ(start);
+	ST_READ(system);
+	ST_READ(bootROMFlag);
+	ST_READ(romChecksum);
+
+	if (!st || start > MovieStart::SaveState || system > GBSystem::DMGCompatMode || bootROMFlag > 1)
+		return false;
+
+	bootROM = bootROMFlag != 0;
+
+	uint16_t pathLen;
+	ST_READ(pathLen);
+
+	romPath.resize(pathLen);
+	st.read(romPath.data(), pathLen);
+
+	ST_READ(rngSeed);
+	ST_READ(rtcTime);
+	ST_READ(startCycle);
+	ST_READ(endCycle);
+
+	// Sizes are checked against the remaining data or MAX_STATE_SIZE, so a corrupt file can't cause huge allocations.
+	const auto readBytes = [&st](std::vector<uint8_t>& buffer) -> bool
+	{
+		uint32_t size;
+		ST_READ(size);
+
+		if (!st || size > FileUtils::remainingBytes(st))
+			return false;
+
+		buffer.resize(size);
+		st.read(reinterpret_cast<char*>(buffer.data()), size);
+		return static_cast<bool>(st);
+	};
+
+	if (!readBytes(startData))
+		return false;
+
+	constexpr uint32_t EVENT_SIZE = sizeof(inputEvent::cycle) + sizeof(inputEvent::state);
+
+	uint32_t eventCount;
+	ST_READ(eventCount);
+
+	if (!st || eventCount == 0 || eventCount > FileUtils::remainingBytes(st) / EVENT_SIZE)
+		return false;
+
+	events.resize(eventCount);
+
+	for (auto& event : events)
+	{
+		ST_READ(event.cycle);
+		ST_READ(event.state);
+	}
+
+	uint32_t keyframeCount;
+	ST_READ(keyframeCount);
+
+	if (!st)
+		return false;
+
+	keyframes.clear();
+
+	for (uint32_t i = 0; i < keyframeCount; i++)
+	{
+		keyframe frame{};
+		ST_READ(frame.cycle);
+		ST_READ(frame.eventIndex);
+		ST_READ(frame.inputState);
+		ST_READ(frame.stateSize);
+
+		if (!st || frame.stateSize == 0 || frame.stateSize > MAX_STATE_SIZE)
+			return false;
+
+		if (!readBytes(frame.data) || frame.eventIndex > eventCount)
+			return false;
+
+		// Keyframes must be in order for the binary search.
+		if (!keyframes.empty() && keyframes.back().cycle >= frame.cycle)
+			return false;
+
+		keyframes.push_back(std::move(frame));
+	}
+
+	return static_cast<bool>(st);
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <iostream>
+
+#include "gbSystem.h"
+
+enum class MovieStart : uint8_t
+{
+	PowerOn,
+	SaveState
+};
+
+// Joypad state changes stamped with the exact emulated cycle they happened on, plus everything needed to reproduce the start of the run.
+// Keyframes are compressed GB states taken every few seconds, so any frame can be reached without replaying from the start.
+struct InputMovie
+{
+	enum class Mode : uint8_t
+	{
+		Inactive,
+		Recording,
+		Playback,
+		Finished // Played past the last input, the joypad is controlled by the user again.
+	};
+
+	struct inputEvent
+	{
+		uint64_t cycle;
+		uint8_t state; // See Joypad::getInputState.
+	};
+
+	struct keyframe
+	{
+		uint64_t cycle;
+		uint32_t eventIndex; // First input event that is not applied yet.
+		uint8_t inputState;
+		uint32_t stateSize; // Uncompressed.
+		std::vector<uint8_t> data;
+	};
+
+	static constexpr std::string_view SIGNATURE = "MegaBoy Input Movie";
+	static constexpr uint16_t VERSION = 1;
+
+	static constexpr uint32_t KEYFRAME_INTERVAL = 600; // In frames.
+
+	// The largest GB state (CGB with 128 KiB of cartridge RAM) is well below this, keyframes claiming more are rejected.
+	static constexpr uint32_t MAX_STATE_SIZE = 1024 * 1024;
+
+	Mode mode { Mode::Inactive };
+	MovieStart start { MovieStart::PowerOn };
+
+	GBSystem system { GBSystem::DMG };
+	bool bootROM { false };
+
+	uint8_t romChecksum { 0 };
+	std::string romPath; // UTF-8
+
+	uint32_t rngSeed { 0 };
+	uint64_t rtcTime { 0 };
+
+	uint64_t startCycle { 0 };
+	uint64_t endCycle { 0 };
+
+	std::vector<uint8_t> startData; // Battery save for power-on start, save state file for save state start.
+	std::vector<inputEvent> events;
+	std::vector<keyframe> keyframes;
+
+	size_t nextEvent { 0 }; // Playback position.
+
+	constexpr bool active() const { return mode != Mode::Inactive; }
+	constexpr bool recording() const { return mode == Mode::Recording; }
+	constexpr bool playing() const { return mode == Mode::Playback; }
+
+	inline void recordInput(uint64_t cycle, uint8_t state)
+	{
+		if (!events.empty() && events.back().state == state)
+			return;
+
+		events.push_back({ cycle, state });
+	}
+
+	// Latest keyframe at or before the given cycle.
+	const keyframe* findKeyframe(uint64_t cycle) const;
+
+	static bool isMovieFile(std::istream& st);
+
+	void write(std::ostream& st) const;
+	bool read(std::istream& st);
+};
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <GLFW/glfw3.h>
 #include <array>
+#include <algorithm>
 
 enum class MegaBoyKey
 {
@@ -68,6 +69,13 @@ public:
 		keyBinds[static_cast<int>(key)] = newBind;
 	}
 
+    // Joypad binds come first, up to MegaBoyKey::Down.
+    static inline bool isJoypadKey(int key)
+    {
+        const auto joypadEnd { keyBinds.begin() + static_cast<int>(MegaBoyKey::Down) + 1 };
+        return std::find(keyBinds.begin(), joypadEnd, key) != joypadEnd;
+    }
+
     static constexpr const char* getMegaBoyKeyName(MegaBoyKey key)
     {
         switch (key)
@@ -0,0 +1,274 @@
+#include <memory>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <vector>
+
+#include "megaboyEnv.h"
+#include "GBCore.h"
+#include "Utils/memstream.h"
+#include "Utils/threadPool.h"
+
+struct MegaBoyEnvFork
+{
+	StateFork state;
+	uint8_t input { 0xFF }; // Joypad input is not a part of the GB state.
+};
+
+struct MegaBoyEnvPool
+{
+	MegaBoyEnvPool(size_t envCount, size_t threadCount) : envs(envCount), grayBuffers(envCount), frameChanged(envCount, 1), pool(threadCount)
+	{}
+
+	std::vector<std::unique_ptr<GBCore>> envs;
+	std::vector<std::vector<uint8_t>> grayBuffers;
+	std::vector<uint8_t> frameChanged; // Set if the screen changed during the last step or reset.
+
+	int grayDownscale { 0 };
+	int grayWidth { 0 };
+	int grayHeight { 0 };
+
+	MegaBoyEnvFork snapshot;
+	std::vector<uint8_t> snapshotFrame; // The framebuffer is not a part of the GB state.
+
+	ThreadPool pool;
+};
+
+namespace
+{
+	void updateGrayscale(MegaBoyEnvPool* pool, size_t env)
+	{
+		if (pool->grayDownscale == 0)
+			return;
+
+		const uint8_t* rgb { pool->envs[env]->ppu->framebufferPtr() };
+		uint8_t* out { pool->grayBuffers[env].data() };
+
+		const int scale { pool->grayDownscale };
+		const int shift { std::countr_zero(static_cast<unsigned>(scale * scale)) };
+
+		for (int y = 0; y < pool->grayHeight; y++)
+		{
+			for (int x = 0; x < pool->grayWidth; x++)
+			{
+				uint32_t sum { 0 };
+
+				for (int sy = 0; sy < scale; sy++)
+				{
+					const uint8_t* px { rgb + ((y * scale + sy) * PPU::SCR_WIDTH + x * scale) * 3 };
+
+					// BT.601 luma in 8 bit fixed point.
+					for (int sx = 0; sx < scale; sx++, px += 3)
+						sum += (px[0] * 77 + px[1] * 150 + px[2] * 29) >> 8;
+				}
+
+				out[y * pool->grayWidth + x] = static_cast<uint8_t>(sum >> shift);
+			}
+		}
+	}
+
+	bool restoreFork(MegaBoyEnvPool* pool, size_t env, const MegaBoyEnvFork& fork)
+	{
+		auto& gb { *pool->envs[env] };
+
+		if (!gb.restoreFork(fork.state))
+			return false;
+
+		gb.joypad.setInputState(fork.input, false);
+		return true;
+	}
+
+	void restoreSnapshot(MegaBoyEnvPool* pool, size_t env)
+	{
+		auto& gb { *pool->envs[env] };
+
+		// Environments restored together share the snapshot pages, and later resets copy only the pages each of them changed.
+		if (!restoreFork(pool, env, pool->snapshot))
+			return;
+
+		std::memcpy(gb.ppu->framebufferPtr(), pool->snapshotFrame.data(), PPU::FRAMEBUFFER_SIZE);
+		pool->frameChanged[env] = 1;
+		updateGrayscale(pool, env);
+	}
+}
+
+MegaBoyEnvPool* megaboy_env_create(const uint8_t* rom, size_t romSize, int envCount, int threadCount, int grayDownscale)
+{
+	if (rom == nullptr || envCount <= 0 || (grayDownscale != 0 && grayDownscale != 1 && grayDownscale != 2 && grayDownscale != 4))
+		return nullptr;
+
+	if (threadCount <= 0)
+		threadCount = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+
+	auto pool { std::make_unique<MegaBoyEnvPool>(static_cast<size_t>(envCount), static_cast<size_t>(std::min(threadCount, envCount))) };
+
+	pool->grayDownscale = grayDownscale;
+
+	if (grayDownscale != 0)
+	{
+		pool->grayWidth = PPU::SCR_WIDTH / grayDownscale;
+		pool->grayHeight = PPU::SCR_HEIGHT / grayDownscale;
+	}
+
+	// Cores are created on this thread, since loading the ROM also sets the global system type, which is the same for all of them.
+	// Only the first core reads the ROM, the others share its data.
+	for (size_t i = 0; i < pool->envs.size(); i++)
+	{
+		pool->envs[i] = std::make_unique<GBCore>();
+
+		if (i == 0)
+		{
+			memstream st { std::span { rom, romSize } };
+
+			if (pool->envs[i]->loadFile(st, "rom.gb", false) != FileLoadResult::SuccessROM)
+				return nullptr;
+		}
+		else if (!pool->envs[i]->loadSharedROM(*pool->envs[0]))
+			return nullptr;
+
+		pool->grayBuffers[i].resize(static_cast<size_t>(pool->grayWidth) * pool->grayHeight);
+		updateGrayscale(pool.get(), i);
+	}
+
+	megaboy_env_save_snapshot(pool.get(), 0);
+	return pool.release();
+}
+
+void megaboy_env_destroy(MegaBoyEnvPool* pool)
+{
+	delete pool;
+}
+
+int megaboy_env_count(const MegaBoyEnvPool* pool)
+{
+	return static_cast<int>(pool->envs.size());
+}
+
+void megaboy_env_step(MegaBoyEnvPool* pool, const uint8_t* actions, int frames)
+{
+	pool->pool.parallelFor(pool->envs.size(), [&](size_t i)
+	{
+		auto& gb { *pool->envs[i] };
+
+		// Joypad state is active low.
+		gb.joypad.setInputState(static_cast<uint8_t>(~actions[i]));
+
+		const uint64_t frameChanges { gb.getFrameChangeCount() };
+
+		for (int f = 0; f < frames; f++)
+			gb.emulateFrame();
+
+		// Grayscale buffer is derived from the framebuffer, so it's still up to date if no frame changed.
+		pool->frameChanged[i] = gb.getFrameChangeCount() != frameChanges;
+
+		if (pool->frameChanged[i])
+			updateGrayscale(pool, i);
+	});
+}
+
+int megaboy_env_save_snapshot(MegaBoyEnvPool* pool, int env)
+{
+	auto& gb { *pool->envs[env] };
+
+	if (!gb.forkState(pool->snapshot.state))
+		return 0;
+
+	pool->snapshot.input = gb.joypad.getInputState();
+	pool->snapshotFrame.assign(gb.ppu->framebufferPtr(), gb.ppu->framebufferPtr() + PPU::FRAMEBUFFER_SIZE);
+	return 1;
+}
+
+void megaboy_env_reset(MegaBoyEnvPool* pool, const uint8_t* mask)
+{
+	if (pool->snapshot.state.pages.empty())
+		return;
+
+	pool->pool.parallelFor(pool->envs.size(), [&](size_t i)
+	{
+		if (mask == nullptr || mask[i] != 0)
+			restoreSnapshot(pool, i);
+	});
+}
+
+MegaBoyEnvFork* megaboy_env_fork(MegaBoyEnvPool* pool, int env)
+{
+	auto fork { std::make_unique<MegaBoyEnvFork>() };
+
+	if (!pool->envs[env]->forkState(fork->state))
+		return nullptr;
+
+	fork->input = pool->envs[env]->joypad.getInputState();
+	return fork.release();
+}
+
+void megaboy_env_fork_free(MegaBoyEnvFork* fork)
+{
+	delete fork;
+}
+
+int megaboy_env_restore(MegaBoyEnvPool* pool, int env, const MegaBoyEnvFork* fork)
+{
+	return restoreFork(pool, static_cast<size_t>(env), *fork) ? 1 : 0;
+}
+
+void megaboy_env_pc_profile(MegaBoyEnvPool* pool, int env, int enable)
+{
+	auto& gb { *pool->envs[env] };
+
+	if (enable == 0)
+		gb.stopPCProfiler();
+	else if (!gb.isPCProfiling())
+		gb.startPCProfiler();
+}
+
+size_t megaboy_env_pc_profile_report(MegaBoyEnvPool* pool, int env, int topCount, char* buffer, size_t bufferSize)
+{
+	auto& gb { *pool->envs[env] };
+	std::string report;
+
+	for (const auto& spot : gb.pcProfiler.topSpots(static_cast<size_t>(std::max(topCount, 0))))
+		report.append(gb.describeHotSpot(spot)).push_back('\n');
+
+	if (buffer != nullptr && bufferSize > 0)
+	{
+		const size_t copied { std::min(report.size(), bufferSize - 1) };
+		std::memcpy(buffer, report.data(), copied);
+		buffer[copied] = '\0';
+	}
+
+	return report.size();
+}
+
+const uint8_t* megaboy_env_framebuffer(const MegaBoyEnvPool* pool, int env)
+{
+	return pool->envs[env]->ppu->framebufferPtr();
+}
+
+int megaboy_env_frame_changed(const MegaBoyEnvPool* pool, int env)
+{
+	return pool->frameChanged[env];
+}
+
+const uint8_t* megaboy_env_grayscale(const MegaBoyEnvPool* pool, int env, int* width, int* height)
+{
+	if (width != nullptr) *width = pool->grayWidth;
+	if (height != nullptr) *height = pool->grayHeight;
+
+	return pool->grayDownscale == 0 ? nullptr : pool->grayBuffers[env].data();
+}
+
+const uint8_t* megaboy_env_wram(const MegaBoyEnvPool* pool, int env, size_t* size)
+{
+	const auto wram { pool->envs[env]->mmu.wramView() };
+
+	if (size != nullptr) *size = wram.size();
+	return wram.data();
+}
+
+const uint8_t* megaboy_env_hram(const MegaBoyEnvPool* pool, int env, size_t* size)
+{
+	const auto hram { pool->envs[env]->mmu.hramView() };
+
+	if (size != nullptr) *size = hram.size();
+	return hram.data();
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// C API for running many headless emulator instances from training code, built as the MegaBoyEnv shared library.
+// All environments of a pool run the same ROM and are stepped together on a thread pool.
+
+#ifdef _WIN32
+#define MEGABOY_ENV_API __declspec(dllexport)
+#else
+#define MEGABOY_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct MegaBoyEnvPool MegaBoyEnvPool;
+typedef struct MegaBoyEnvFork MegaBoyEnvFork;
+
+// Action bits, set means pressed.
+enum
+{
+	MEGABOY_BUTTON_A = 1 << 0,
+	MEGABOY_BUTTON_B = 1 << 1,
+	MEGABOY_BUTTON_SELECT = 1 << 2,
+	MEGABOY_BUTTON_START = 1 << 3,
+	MEGABOY_BUTTON_RIGHT = 1 << 4,
+	MEGABOY_BUTTON_LEFT = 1 << 5,
+	MEGABOY_BUTTON_UP = 1 << 6,
+	MEGABOY_BUTTON_DOWN = 1 << 7
+};
+
+// grayDownscale is 0 to disable the grayscale observation, or 1, 2 or 4 for a 160x144, 80x72 or 40x36 buffer.
+// threadCount of 0 uses all hardware threads. Returns NULL if the ROM is invalid.
+// The state right after power-on is taken as the initial reset snapshot.
+MEGABOY_ENV_API MegaBoyEnvPool* megaboy_env_create(const uint8_t* rom, size_t romSize, int envCount, int threadCount, int grayDownscale);
+MEGABOY_ENV_API void megaboy_env_destroy(MegaBoyEnvPool* pool);
+
+MEGABOY_ENV_API int megaboy_env_count(const MegaBoyEnvPool* pool);
+
+// Holds actions[i] on environment i for the given number of frames.
+MEGABOY_ENV_API void megaboy_env_step(MegaBoyEnvPool* pool, const uint8_t* actions, int frames);
+
+// Takes the current state of the given environment as the reset snapshot. Returns 0 if the state can't be saved.
+MEGABOY_ENV_API int megaboy_env_save_snapshot(MegaBoyEnvPool* pool, int env);
+
+// Restores the snapshot on every environment with a non-zero mask entry, or on all of them if mask is NULL.
+MEGABOY_ENV_API void megaboy_env_reset(MegaBoyEnvPool* pool, const uint8_t* mask);
+
+// Forks the state of an environment for tree search. Memory pages not written since the last fork or restore on that environment are shared, not copied.
+// Returns NULL while the boot ROM is running. Forks don't reference the pool and are freed with megaboy_env_fork_free.
+MEGABOY_ENV_API MegaBoyEnvFork* megaboy_env_fork(MegaBoyEnvPool* pool, int env);
+MEGABOY_ENV_API void megaboy_env_fork_free(MegaBoyEnvFork* fork);
+
+// Restores a fork of any environment running the same ROM. The framebuffer and grayscale views update on the next step. Returns 0 on failure.
+MEGABOY_ENV_API int megaboy_env_restore(MegaBoyEnvPool* pool, int env, const MegaBoyEnvFork* fork);
+
+// Counts executed cycles per (ROM bank, address) on an environment while enabled, which slows down its steps a bit.
+MEGABOY_ENV_API void megaboy_env_pc_profile(MegaBoyEnvPool* pool, int env, int enable);
+
+// Writes the topCount hottest addresses with their share of the profiled cycles and disassembly, one per line.
+// The report is cut to fit bufferSize and NUL terminated. Returns the length of the full report.
+MEGABOY_ENV_API size_t megaboy_env_pc_profile_report(MegaBoyEnvPool* pool, int env, int topCount, char* buffer, size_t bufferSize);
+
+// The framebuffer is the PPU's front buffer, not a copy. The PPU swaps its buffers every frame,
+// so the pointer has to be fetched again after each step, reset or restore.
+MEGABOY_ENV_API const uint8_t* megaboy_env_framebuffer(const MegaBoyEnvPool* pool, int env); // 160x144 RGB
+
+// Returns 1 if any frame rendered during the last step differed from the one before it, or if the last reset replaced the screen.
+// Observations of an environment that returns 0 are the same as before the step.
+MEGABOY_ENV_API int megaboy_env_frame_changed(const MegaBoyEnvPool* pool, int env);
+
+// Grayscale buffer owned by the pool, valid until it's destroyed. Contents change on the next step or reset.
+MEGABOY_ENV_API const uint8_t* megaboy_env_grayscale(const MegaBoyEnvPool* pool, int env, int* width, int* height);
+
+// Views into the emulator memory, no data is copied. Contents change on the next step or reset.
+MEGABOY_ENV_API const uint8_t* megaboy_env_wram(const MegaBoyEnvPool* pool, int env, size_t* size);
+MEGABOY_ENV_API const uint8_t* megaboy_env_hram(const MegaBoyEnvPool* pool, int env, size_t* size);
+
+#ifdef __cplusplus
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// Executed T-cycles per guest instruction address. ROM code is told apart by bank, code running from RAM only by address.
+// Counters are allocated when profiling starts, an idle profiler only costs the active() check outside of the main loop.
+class PCProfiler
+{
+public:
+	static constexpr uint32_t ROM_BANK_SIZE = 0x4000;
+	static constexpr uint16_t NON_ROM_START = 0x8000;
+
+	struct hotSpot
+	{
+		bool inROM;
+		uint16_t bank; // Always 0 outside of ROM.
+		uint16_t addr;
+		uint32_t cycles;
+	};
+
+	inline void start(size_t romSize)
+	{
+		romCounters = static_cast<uint32_t>(romSize);
+		counters.assign(romSize + (0x10000 - NON_ROM_START), 0);
+		total = 0;
+	}
+	inline void stop()
+	{
+		counters.clear();
+		counters.shrink_to_fit();
+	}
+	inline void clear()
+	{
+		std::fill(counters.begin(), counters.end(), 0);
+		total = 0;
+	}
+
+	inline bool active() const { return !counters.empty(); }
+
+	// romBank is the bank mapped where pc is, ignored outside of ROM.
+	inline void add(uint16_t pc, uint16_t romBank, uint8_t cycles)
+	{
+		uint32_t ind;
+
+		if (pc >= NON_ROM_START)
+			ind = romCounters + (pc - NON_ROM_START);
+		else
+			ind = (romBank * ROM_BANK_SIZE + (pc & (ROM_BANK_SIZE - 1))) % romCounters;
+
+		// Saturates instead of wrapping around on long sessions.
+		const uint32_t val { counters[ind] + cycles };
+		counters[ind] = val < cycles ? UINT32_MAX : val;
+		total += cycles;
+	}
+
+	std::vector<hotSpot> topSpots(size_t count) const
+	{
+		std::vector<hotSpot> spots;
+
+		for (uint32_t i = 0; i < counters.size(); i++)
+		{
+			if (counters[i] == 0)
+				continue;
+
+			if (i < romCounters)
+				spots.push_back({ true, static_cast<uint16_t>(i / ROM_BANK_SIZE), static_cast<uint16_t>((i < ROM_BANK_SIZE ? 0 : ROM_BANK_SIZE) + i % ROM_BANK_SIZE), counters[i] });
+			else
+				spots.push_back({ false, 0, static_cast<uint16_t>(NON_ROM_START + (i - romCounters)), counters[i] });
+		}
+
+		count = std::min(count, spots.size());
+		std::partial_sort(spots.begin(), spots.begin() + count, spots.end(), [](const hotSpot& a, const hotSpot& b) { return a.cycles > b.cycles; });
+		spots.resize(count);
+		return spots;
+	}
+
+	inline uint64_t totalCycles() const { return total; }
+private:
+	std::vector<uint32_t> counters;
+	uint32_t romCounters { 0 };
+	uint64_t total { 0 };
+};
\ No newline at end of file